@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+#include <valfuzz/fuzz.hpp>
+
+namespace valfuzz
+{
+
+/* Checkpoints */
+
+#define CHECKPOINT_HEADER "valfuzz checkpoint 1"
+#define CHECKPOINT_DEFAULT_INTERVAL 60  // seconds
+#define CHECKPOINT_STATE_NAME "state"
+#define CHECKPOINT_COVERAGE_NAME "coverage"
+#define CHECKPOINT_CORPUS_NAME "corpus"
+
+/**
+ * The state of a fuzz campaign, saved with --checkpoint <dir> every
+ * get_checkpoint_interval() seconds, on SIGINT and SIGTERM and at the
+ * end of the campaign, so that --resume <dir> continues where it was
+ * stopped. The directory holds:
+ *
+ *   state     this struct, as text
+ *   coverage  the global coverage map and value profile
+ *   corpus/   one pack per target, like a --corpus directory
+ *
+ * The engine of a worker is a function of the seed and of its next
+ * iteration, so those two are its whole position. Targets are matched
+ * by name, a campaign can be resumed with more or fewer workers. The
+ * coverage map is restored only by the same build instrumented with
+ * guards; otherwise it is rebuilt by running the corpus once.
+ */
+struct checkpoint_worker
+{
+  uint64_t              next_iteration = 0;
+  std::vector<uint64_t> execs;     // by target
+  std::vector<double>   energies;  // by target
+};
+
+struct checkpoint
+{
+  uint64_t                       seed       = 0;
+  uint64_t                       iterations = 0;
+  std::vector<std::string>       targets;
+  std::vector<checkpoint_worker> workers;
+};
+
+std::optional<std::filesystem::path>&   get_checkpoint_dir();
+std::atomic<long unsigned int>&         get_checkpoint_interval();
+std::optional<std::filesystem::path>&   get_resume_dir();
+
+void set_checkpoint_dir(const std::filesystem::path &dir);
+void set_checkpoint_interval(long unsigned int seconds);
+/* Resume from dir, and keep saving checkpoints there */
+void set_resume_dir(const std::filesystem::path &dir);
+
+bool write_checkpoint_state(const std::filesystem::path &path,
+                            const checkpoint &state);
+std::optional<checkpoint>
+read_checkpoint_state(const std::filesystem::path &path);
+
+/* Save the campaign to get_checkpoint_dir() */
+void save_checkpoint();
+/* Save the campaign if the interval has passed since the last save */
+void checkpoint_poll();
+/* Load the seed, counters, corpus and coverage of get_resume_dir(),
+ * before the workers are made */
+void load_checkpoint();
+/* Give the workers just made their position and scheduler energies */
+void restore_checkpoint_workers();
+/* Stop the campaign on SIGINT and SIGTERM, so it is saved; a second
+ * signal kills the process */
+void install_checkpoint_signals();
+
+} // namespace valfuzz
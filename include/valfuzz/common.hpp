@@ -6,11 +6,16 @@
 #pragma once
 
 #include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
 #include <thread>
+#include <vector>
 
 namespace valfuzz
 {
@@ -18,11 +23,95 @@ namespace valfuzz
 typedef std::function<void(std::string)>        test_function;
 typedef std::pair<std::string, test_function>   test_pair;
 
+/**
+ * A persistent pool of worker threads that run the tests, the fuzz
+ * workers and the setup of the benchmarks, so threads are started
+ * once per process. Every worker has its own deque of tasks behind
+ * its own lock: a task submitted from a worker goes to its deque,
+ * one submitted from another thread is dealt round robin. A worker
+ * runs its tasks in submission order from the front of its deque and,
+ * when it is empty, steals from the back of the others. A thread that
+ * waits for tasks runs them too; one waiting in parallel_for runs only
+ * the chunks of its own call, so a test that uses it never runs other
+ * tests nested on its stack.
+ */
+class thread_pool
+{
+public:
+  typedef std::function<void()> task;
+
+  thread_pool() = default;
+  ~thread_pool();
+  thread_pool(const thread_pool &)            = delete;
+  thread_pool &operator=(const thread_pool &) = delete;
+
+  /* Stop the current workers and start num_threads new ones */
+  void start(size_t num_threads);
+  /* Run the queued tasks and join the workers */
+  void stop();
+  size_t size() const noexcept
+  {
+    return threads.size();
+  }
+
+  void submit(task t);
+  /* Run tasks until every submitted task is done */
+  void wait();
+  /* Split [0, count) in a chunk per thread, run them and wait for
+   * them, including on the calling thread */
+  void parallel_for(size_t count,
+                    const std::function<void(size_t, size_t)> &body);
+
+private:
+  /* The chunks of one parallel_for */
+  struct task_group
+  {
+    std::atomic<size_t> remaining = 0;  // not done
+    std::atomic<size_t> queued    = 0;  // not started
+  };
+
+  struct queued_task
+  {
+    task        run;
+    task_group *group = nullptr;
+  };
+
+  struct alignas(64) task_queue
+  {
+    std::mutex              mutex;
+    std::deque<queued_task> tasks;
+  };
+
+  void push(task t, task_group *group);
+  /* Run one task of group, or of any group if nullptr, from queue
+   * first or stolen from another one */
+  bool run_one(size_t first, task_group *group);
+  void help_until(const std::atomic<size_t> &remaining, task_group *group);
+  void work(size_t index);
+
+  std::vector<std::thread>      threads;
+  std::unique_ptr<task_queue[]> queues;
+  size_t                        num_queues = 0;
+  std::atomic<size_t>           next_queue = 0;
+  std::atomic<size_t>           pending    = 0;  // submitted, not done
+  std::atomic<size_t>           queued     = 0;  // not started
+  std::atomic<size_t>           waiters    = 0;
+  std::mutex                    sleep_mutex;
+  std::condition_variable       work_cv;
+  std::condition_variable       done_cv;
+  bool                          stopping = false;
+};
+
 std::mutex&                       get_stream_mutex();
 std::atomic<bool>&                get_verbose();
 std::atomic<long unsigned int>&   get_max_num_threads();
 std::mutex&                       get_tests_mutex();
 std::atomic<bool>&                get_is_threaded();
-std::vector<std::thread>&         get_thread_pool();
+/* Started with get_max_num_threads() workers on first use, and
+ * restarted if that changed */
+thread_pool&                      get_thread_pool();
+std::atomic<long unsigned int>&   get_seed();
+
+void set_seed(long unsigned int seed);
 
 } // namespace valfuzz
@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace valfuzz
+{
+
+/* Corpus on disk */
+
+#define CORPUS_PACK_NAME "corpus.pack"
+#define CORPUS_PACK_MAGIC "VFZPACK1"
+
+/**
+ * A corpus directory has one subdirectory per fuzz target. Every
+ * input is stored in a file named after the hash of its content, so
+ * the same input is never saved twice. Loading thousands of small
+ * files is slow, so the inputs are also stored in a packed file,
+ * CORPUS_PACK_NAME, which is memory mapped at startup: only the
+ * files that are not in the pack yet are opened, and the pack is
+ * rewritten when there are any.
+ *
+ * Pack layout, integers are 64 bit in host byte order:
+ *   magic[8] count { hash offset size }[count] data
+ */
+
+std::optional<std::filesystem::path>&   get_corpus_dir();
+std::vector<std::filesystem::path>&     get_seed_paths();
+
+void set_corpus_dir(const std::filesystem::path &dir);
+/* A seed file, or a directory of them, for every fuzz target. Seeds
+ * are read as they are, like the inputs of libFuzzer's corpora */
+void add_seed_path(const std::filesystem::path &path);
+
+/* FNV-1a hash of an input */
+uint64_t hash_input(const uint8_t *data, size_t size);
+/* The file name of an input, its hash as 16 hex digits */
+std::string input_file_name(const uint8_t *data, size_t size);
+/* The directory of a target in a corpus directory */
+std::filesystem::path target_corpus_dir(const std::filesystem::path &dir,
+                                        const std::string &target_name);
+
+/* Write to a temporary file and rename it, so readers never see a
+ * partial file */
+bool write_file_atomically(const std::filesystem::path &path,
+                           const uint8_t *data, size_t size);
+/* Write the input to dir atomically, does nothing if it exists */
+void save_input(const std::filesystem::path &dir, const uint8_t *data,
+                size_t size);
+/* Read every input of dir, packed inputs first */
+std::vector<std::vector<uint8_t>>
+load_inputs(const std::filesystem::path &dir);
+/* Rewrite the pack of dir with the given inputs */
+void write_pack(const std::filesystem::path &dir,
+                const std::vector<std::vector<uint8_t>> &inputs);
+
+/* Load the corpus of every fuzz target from get_corpus_dir() */
+void load_corpus();
+/* Load the files of get_seed_paths(), directories recursively */
+void load_seeds();
+
+} // namespace valfuzz
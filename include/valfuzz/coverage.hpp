@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace valfuzz
+{
+
+/* Coverage */
+
+#define COVERAGE_MAP_SIZE (1 << 16)
+#define CMP_TABLE_SIZE 256
+#define CMP_TOKEN_TABLE_SIZE 64
+#define CMP_MAX_TOKEN_SIZE 32
+#define VALUE_PROFILE_MAP_BITS (1 << 16)
+
+/**
+ * Edge coverage collected through SanitizerCoverage. Build the code
+ * under test with -fsanitize-coverage=trace-pc-guard (clang) or
+ * -fsanitize-coverage=trace-pc (gcc), see the VALFUZZ_ENABLE_COVERAGE
+ * cmake option. Each fuzz worker counts edge hits in its own map and
+ * merges them into a global map only when an input finds something
+ * new.
+ */
+
+/**
+ * With -fsanitize-coverage=trace-cmp the comparisons of the code
+ * under test are reported too. The constant operands, the case values
+ * of switches and the buffers given to memcmp, strcmp and friends
+ * (reported by the sanitizer runtimes, e.g. with -fsanitize=address)
+ * are kept in a per-thread table, one entry per comparison site; the
+ * fuzz loop moves the entries that changed to the worker's mutation
+ * dictionary once per batch. With value profile, the pair (site,
+ * number of differing bits between the operands) is also a coverage
+ * feature, so inputs that get closer to a magic value are kept.
+ */
+
+std::atomic<long unsigned int>&   get_coverage_edges();
+std::atomic<bool>&                get_use_value_profile();
+
+void set_use_value_profile(bool use_value_profile);
+
+/* Give the calling thread its own map, otherwise hits are counted in
+ * a map shared by all the threads that did not call this */
+void coverage_thread_init();
+/* Clear the calling thread's map before running an input */
+void coverage_reset();
+/* True if the last input hit any instrumented code */
+bool coverage_has_hits();
+/* Edges executed by the calling thread so far, never cleared */
+uint64_t coverage_edge_hits();
+/* Merge the thread's map into the global one and clear it, returns
+ * true if the last input reached new edges or new hit counts, or new
+ * value profile features */
+bool coverage_update();
+/* Pass the comparison operands recorded by this thread since the last
+ * call to add */
+void coverage_take_cmp_operands(
+  const std::function<void(const uint8_t *, size_t)> &add);
+/* Move the global map to shared memory, so that processes forked
+ * afterwards merge their coverage into the same map. Linux only */
+void coverage_share_global_map();
+/* Copy of the global map and value profile, to checkpoint a campaign */
+std::vector<uint64_t> coverage_save();
+/* Merge a copy made by coverage_save(), returns false if it was made
+ * by a different build or without guards */
+bool coverage_load(const std::vector<uint64_t> &words);
+
+} // namespace valfuzz
+
+extern "C"
+{
+  void __sanitizer_cov_trace_pc_guard_init(uint32_t *start, uint32_t *stop);
+  void __sanitizer_cov_trace_pc_guard(uint32_t *guard);
+  void __sanitizer_cov_trace_pc();
+
+  void __sanitizer_cov_trace_cmp1(uint8_t arg1, uint8_t arg2);
+  void __sanitizer_cov_trace_cmp2(uint16_t arg1, uint16_t arg2);
+  void __sanitizer_cov_trace_cmp4(uint32_t arg1, uint32_t arg2);
+  void __sanitizer_cov_trace_cmp8(uint64_t arg1, uint64_t arg2);
+  void __sanitizer_cov_trace_const_cmp1(uint8_t arg1, uint8_t arg2);
+  void __sanitizer_cov_trace_const_cmp2(uint16_t arg1, uint16_t arg2);
+  void __sanitizer_cov_trace_const_cmp4(uint32_t arg1, uint32_t arg2);
+  void __sanitizer_cov_trace_const_cmp8(uint64_t arg1, uint64_t arg2);
+  void __sanitizer_cov_trace_cmpf(float arg1, float arg2);
+  void __sanitizer_cov_trace_cmpd(double arg1, double arg2);
+  void __sanitizer_cov_trace_switch(uint64_t val, uint64_t *cases);
+
+  void __sanitizer_weak_hook_memcmp(void *caller_pc, const void *s1,
+                                    const void *s2, size_t n, int result);
+  void __sanitizer_weak_hook_strncmp(void *caller_pc, const char *s1,
+                                     const char *s2, size_t n, int result);
+  void __sanitizer_weak_hook_strcmp(void *caller_pc, const char *s1,
+                                    const char *s2, int result);
+  void __sanitizer_weak_hook_strncasecmp(void *caller_pc, const char *s1,
+                                         const char *s2, size_t n,
+                                         int result);
+  void __sanitizer_weak_hook_strcasecmp(void *caller_pc, const char *s1,
+                                        const char *s2, int result);
+  void __sanitizer_weak_hook_strstr(void *caller_pc, const char *s1,
+                                    const char *s2, char *result);
+}
@@ -0,0 +1,173 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <valfuzz/fuzz.hpp>
+
+namespace valfuzz
+{
+
+#define MAX_FUZZ_INPUT_SIZE 4096
+
+/**
+ * Decodes typed values from a fuzz input, one is passed to every
+ * FUZZME target as `provider`. Values are read in place from the
+ * underlying buffer, strings and byte ranges are returned as views
+ * into it. When the input is exhausted values are zero.
+ *
+ * A provider either reads a fixed input, used to replay or mutate a
+ * saved input, or generates a random input of random length on
+ * demand. Generated bytes are written to the buffer so the consumed
+ * input can be saved afterwards with data() and size().
+ */
+class data_provider
+{
+public:
+  /* Read a fixed input */
+  data_provider(const uint8_t *data, size_t size) noexcept
+    : input(data), input_size(size), input_end(size)
+  {
+  }
+
+  /* Generate a random input in buffer, at most capacity bytes long.
+   * The input is seeded with one draw from engine */
+  data_provider(uint8_t *buffer, size_t capacity,
+                random_engine &engine) noexcept
+    : input(buffer), buffer(buffer), capacity(capacity),
+      generator_seed(engine())
+  {
+  }
+
+  template <typename T> T consume()
+  {
+    static_assert(std::is_arithmetic_v<T>, "consume needs arithmetic types");
+    T value{};
+    if constexpr (std::is_same_v<T, bool>)
+    {
+      uint8_t byte = 0;
+      read(&byte, 1);
+      value = (byte & 1) != 0;
+    }
+    else
+    {
+      read(&value, sizeof(T));
+    }
+    return value;
+  }
+
+  /* A value in [min, max] */
+  template <typename T> T consume_in_range(T min, T max)
+  {
+    static_assert(std::is_arithmetic_v<T>, "consume needs arithmetic types");
+    if (min >= max)
+      return min;
+    if constexpr (std::is_floating_point_v<T>)
+    {
+      uint64_t bits = consume<uint64_t>();
+      T unit = static_cast<T>(bits >> 11) * static_cast<T>(0x1.0p-53);
+      // max - min overflows to inf for ranges wider than half the type
+      T value = min + unit * max - unit * min;
+      return value > max ? max : value;
+    }
+    else
+    {
+      typedef std::make_unsigned_t<T> U;
+      const U range =
+        static_cast<U>(static_cast<U>(max) - static_cast<U>(min));
+      U offset = consume<U>();
+      if (range != std::numeric_limits<U>::max())
+        offset = static_cast<U>(offset % static_cast<U>(range + 1));
+      return static_cast<T>(static_cast<U>(static_cast<U>(min) + offset));
+    }
+  }
+
+  /* Up to n bytes, shorter if the input ends */
+  std::string_view consume_bytes(size_t n)
+  {
+    ensure(n);
+    size_t len = n < input_end - position ? n : input_end - position;
+    std::string_view view(reinterpret_cast<const char *>(input + position),
+                          len);
+    position += len;
+    return view;
+  }
+
+  /* A length prefixed string of at most max_len bytes */
+  std::string_view consume_string(size_t max_len)
+  {
+    size_t len = consume_in_range<size_t>(0, max_len);
+    return consume_bytes(len);
+  }
+
+  std::string_view consume_remaining()
+  {
+    return consume_bytes(remaining());
+  }
+
+  size_t remaining()
+  {
+    if (buffer != nullptr && !generating)
+      start_generating();
+    return input_end - position;
+  }
+
+  /* Generate the rest of a random input, so that data() and size()
+   * describe the whole input */
+  void materialize();
+
+  const uint8_t *data() const noexcept
+  {
+    return input;
+  }
+  /* Bytes available so far */
+  size_t size() const noexcept
+  {
+    return input_size;
+  }
+  size_t consumed() const noexcept
+  {
+    return position;
+  }
+
+private:
+  void read(void *out, size_t n)
+  {
+    ensure(n);
+    size_t len = n < input_end - position ? n : input_end - position;
+    std::memcpy(out, input + position, len);
+    position += len;
+  }
+
+  void ensure(size_t n)
+  {
+    if (buffer != nullptr && position + n > input_size)
+      generate(position + n);
+  }
+
+  void start_generating();
+  void generate(size_t up_to);
+
+  const uint8_t *input = nullptr;
+  size_t input_size    = 0;  // bytes in the buffer
+  size_t input_end     = 0;  // length of the input
+  size_t position      = 0;
+
+  /* random inputs */
+  uint8_t *buffer         = nullptr;
+  size_t capacity         = 0;
+  uint64_t generator_seed = 0;
+  bool generating         = false;
+  // seeded only if the target reads the input
+  std::optional<random_engine> generator;
+};
+
+} // namespace valfuzz
@@ -0,0 +1,252 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iterator>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <valfuzz/data_provider.hpp>
+#include <valfuzz/fuzz.hpp>
+#include <valfuzz/reproducer.hpp>
+#include <valfuzz/test.hpp>
+
+namespace valfuzz
+{
+
+/* Differential fuzzing */
+
+#define DIFF_BATCH_SIZE 256
+#define DIFF_MAX_PRINTED_ELEMENTS 16
+#define DIFF_DEFAULT_TOLERANCE 0.0
+
+/**
+ * Compares an optimized implementation against a reference one.
+ * Every iteration generates a batch of up to DIFF_BATCH_SIZE inputs
+ * with generator(provider), runs ref_fn over the whole batch, then
+ * opt_fn over the whole batch, and compares the outputs. The batch
+ * ends early when the generator used up the provider's input.
+ *
+ * Outputs are compared with ==, floating point values with a
+ * relative tolerance, see set_diff_tolerance(), and containers
+ * element by element. On a mismatch the smallest failing input of the
+ * batch is printed with both outputs, and only that input is saved
+ * as the reproducer. Generators should draw from the provider, or
+ * from get_random<T>(), so that the input can be replayed.
+ *
+ *   FUZZ_DIFF(sum_diff, "Sum SIMD", sum, sum_simd,
+ *             [](valfuzz::data_provider &p) { ... return values; });
+ */
+#define FUZZ_DIFF(fun_name, pretty_name, ref_fn, opt_fn, generator)            \
+  static struct fun_name##_register                                            \
+  {                                                                            \
+    fun_name##_register()                                                      \
+    {                                                                          \
+      valfuzz::add_fuzz_test(                                                  \
+        pretty_name,                                                           \
+        [](const std::string &test_name, valfuzz::data_provider &provider)     \
+        {                                                                      \
+          valfuzz::run_diff(test_name, provider, ref_fn, opt_fn,               \
+                            generator);                                        \
+        });                                                                    \
+    }                                                                          \
+  } fun_name##_register_instance
+
+std::atomic<double>&   get_diff_tolerance();
+
+/* Relative tolerance for floating point outputs, 0 means exact */
+void set_diff_tolerance(double tolerance);
+
+template <typename T, typename = void>
+struct is_diff_iterable : std::false_type
+{
+};
+template <typename T>
+struct is_diff_iterable<
+  T, std::void_t<decltype(std::begin(std::declval<T &>())),
+                 decltype(std::end(std::declval<T &>()))>> : std::true_type
+{
+};
+
+template <typename T, typename = void>
+struct is_diff_printable : std::false_type
+{
+};
+template <typename T>
+struct is_diff_printable<T,
+                         std::void_t<decltype(std::declval<std::ostream &>()
+                                              << std::declval<const T &>())>>
+  : std::true_type
+{
+};
+
+template <typename T>
+bool diff_equal(const T &a, const T &b, double tolerance)
+{
+  if constexpr (std::is_floating_point_v<T>)
+  {
+    if (a == b)
+      return true;
+    if (std::isnan(a) || std::isnan(b))
+      return std::isnan(a) && std::isnan(b);
+    const double x = (double) a;
+    const double y = (double) b;
+    return std::fabs(x - y) <=
+           tolerance * std::max({1.0, std::fabs(x), std::fabs(y)});
+  }
+  else if constexpr (is_diff_iterable<const T>::value &&
+                     !std::is_same_v<T, std::string>)
+  {
+    auto it_a = std::begin(a);
+    auto it_b = std::begin(b);
+    for (; it_a != std::end(a) && it_b != std::end(b); ++it_a, ++it_b)
+    {
+      if (!diff_equal(*it_a, *it_b, tolerance))
+        return false;
+    }
+    return it_a == std::end(a) && it_b == std::end(b);
+  }
+  else
+  {
+    return a == b;
+  }
+}
+
+template <typename T> void diff_print(std::ostream &out, const T &value)
+{
+  if constexpr (std::is_same_v<T, char> || std::is_same_v<T, signed char> ||
+                std::is_same_v<T, unsigned char>)
+  {
+    out << (int) value;
+  }
+  else if constexpr (is_diff_printable<T>::value)
+  {
+    out << value;
+  }
+  else if constexpr (is_diff_iterable<const T>::value)
+  {
+    size_t printed = 0;
+    out << "{";
+    for (const auto &element : value)
+    {
+      if (printed == DIFF_MAX_PRINTED_ELEMENTS)
+      {
+        out << ", ...";
+        break;
+      }
+      out << (printed == 0 ? "" : ", ");
+      diff_print(out, element);
+      printed++;
+    }
+    out << "}";
+  }
+  else
+  {
+    out << "<" << sizeof(T) << " bytes>";
+  }
+}
+
+/**
+ * The inputs and outputs of a batch, kept per thread so the vectors
+ * are reused by every iteration
+ */
+template <typename Input, typename Output> struct diff_batch
+{
+  std::vector<Input>         inputs;
+  std::vector<random_engine> states;  // before generating each input
+  std::vector<size_t>        begins;  // slice of the provider's input
+  std::vector<size_t>        ends;
+  std::vector<Output>        expected;
+  std::vector<Output>        actual;
+
+  void clear() noexcept
+  {
+    inputs.clear();
+    states.clear();
+    begins.clear();
+    ends.clear();
+    expected.clear();
+    actual.clear();
+  }
+};
+
+/* Print a mismatch like a failed assertion, the first of its bucket */
+void report_diff_mismatch(const std::string &test_name, size_t mismatches,
+                          size_t batch_size, size_t index,
+                          const std::string &input,
+                          const std::string &expected,
+                          const std::string &actual);
+
+template <typename Ref, typename Opt, typename Gen>
+void run_diff(const std::string &test_name, data_provider &provider,
+              Ref &&ref_fn, Opt &&opt_fn, Gen &&generator)
+{
+  typedef std::decay_t<std::invoke_result_t<Gen &, data_provider &>> input_t;
+  typedef std::decay_t<std::invoke_result_t<Ref &, const input_t &>> output_t;
+  thread_local diff_batch<input_t, output_t> batch;
+  batch.clear();
+
+  random_engine &engine = get_random_engine();
+  for (size_t i = 0; i < DIFF_BATCH_SIZE; i++)
+  {
+    batch.states.push_back(engine);
+    batch.begins.push_back(provider.consumed());
+    batch.inputs.push_back(generator(provider));
+    batch.ends.push_back(provider.consumed());
+    // generators that only use get_random<T>() fill the whole batch
+    if (batch.ends[i] > batch.begins[i] && provider.remaining() == 0)
+      break;
+  }
+
+  // one implementation at a time, so each stays hot in the caches
+  for (const input_t &input : batch.inputs)
+  {
+    batch.expected.push_back(ref_fn(input));
+  }
+  for (const input_t &input : batch.inputs)
+  {
+    batch.actual.push_back(opt_fn(input));
+  }
+
+  const double tolerance = get_diff_tolerance().load();
+  size_t mismatches = 0;
+  size_t smallest   = 0;
+  for (size_t i = 0; i < batch.inputs.size(); i++)
+  {
+    if (diff_equal(batch.expected[i], batch.actual[i], tolerance))
+      continue;
+    const size_t size = batch.ends[i] - batch.begins[i];
+    if (mismatches == 0 ||
+        size < batch.ends[smallest] - batch.begins[smallest])
+      smallest = i;
+    mismatches++;
+  }
+  if (mismatches == 0)
+    return;
+
+  // a mismatch of a known bucket is only counted
+  if (assertion_failed(test_name, __FILE__, __LINE__))
+  {
+    std::ostringstream input, expected, actual;
+    diff_print(input, batch.inputs[smallest]);
+    diff_print(expected, batch.expected[smallest]);
+    diff_print(actual, batch.actual[smallest]);
+    report_diff_mismatch(test_name, mismatches, batch.inputs.size(),
+                         smallest, input.str(), expected.str(),
+                         actual.str());
+  }
+  // replaying the slice generates the failing input first
+  set_failing_input(batch.states[smallest],
+                    provider.data() + batch.begins[smallest],
+                    batch.ends[smallest] - batch.begins[smallest]);
+}
+
+} // namespace valfuzz
@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace valfuzz
+{
+
+/* Failure buckets */
+
+#define FAILURE_BUCKETS 1024
+#define FAILURE_SITE_SIZE 128
+#define FAILURE_BACKTRACE_FRAMES 16
+
+/**
+ * Failures are bucketed by a signature: the test name and the file
+ * and line of the assertion, or the test name, the signal and a hash
+ * of the backtrace for a crash. Only the first failure of a bucket is
+ * printed and saved as a reproducer; the others are counted with an
+ * atomic increment, so a target that keeps failing does not make
+ * every worker wait on the stream mutex. The counts are printed at
+ * the end. The table is open addressed and never shrinks; once it is
+ * full every new signature is reported. In isolated mode it is
+ * shared by all the processes.
+ */
+struct failure_bucket
+{
+  std::atomic<uint64_t> signature;  // zero if free
+  std::atomic<uint64_t> count;
+  std::atomic<bool>     saved;      // a reproducer was saved
+  std::atomic<bool>     ready;      // site was written
+  char                  site[FAILURE_SITE_SIZE];
+};
+
+struct failure_table
+{
+  failure_bucket buckets[FAILURE_BUCKETS];
+};
+
+/* The table of the process, shared after failures_share() */
+failure_table& get_failure_table();
+
+uint64_t failure_signature(const std::string &name, const char *file,
+                           int line) noexcept;
+uint64_t crash_signature(const std::string &name, int signal,
+                         uint64_t backtrace) noexcept;
+/* Count a failure in the bucket of its signature, returns true for the
+ * first one */
+bool count_failure(uint64_t signature, const std::string &name,
+                   const char *file, int line,
+                   failure_table &table = get_failure_table()) noexcept;
+bool count_crash(uint64_t signature, const std::string &name, int signal,
+                 failure_table &table = get_failure_table()) noexcept;
+/* Called by the assertions: mark the test as failed and count the
+ * failure, returns true if it should be printed */
+bool assertion_failed(const std::string &name, const char *file,
+                      int line) noexcept;
+/* Signature of the first failure on this thread since it was reset,
+ * zero if none */
+uint64_t& get_thread_failure_signature();
+/* True only the first time for each bucket, to save one reproducer */
+bool claim_failure(uint64_t signature,
+                   failure_table &table = get_failure_table()) noexcept;
+/* Number of failures counted in the bucket of signature */
+uint64_t failure_count(uint64_t signature,
+                       failure_table &table = get_failure_table()) noexcept;
+/* Find the code of valfuzz and load what backtrace() needs, before
+ * backtrace_signature() is called from a signal handler */
+void backtrace_init() noexcept;
+/* Hash of the innermost return addresses of the calling thread that
+ * are not in valfuzz, so it does not depend on how the fuzz loop
+ * called the target. Async signal safe once backtrace_init() ran.
+ * Zero if they cannot be read or it did not run */
+uint64_t backtrace_signature() noexcept;
+/* Move the table to memory shared with the processes forked later */
+void failures_share();
+/* Print the buckets that failed more than once */
+void report_failure_counts(failure_table &table = get_failure_table());
+
+} // namespace valfuzz
@@ -7,17 +7,27 @@
 
 #include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <deque>
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <random>
+#if __cplusplus >= 202002L // C++20
+#include <span>
+#endif
 #include <string>
 #include <thread>
 #include <tuple>
+#include <vector>
 #include <valfuzz/common.hpp>
+#include <valfuzz/coverage.hpp>
 
 namespace valfuzz
 {
@@ -25,11 +35,100 @@ namespace valfuzz
 /* Fuzzer */
 
 #define MAX_RANDOM_STRING_LEN 1024
+#define FUZZ_BATCH_SIZE 1024
+
+/**
+ * xoshiro256++ pseudo random number generator.
+ *
+ * Every thread owns its own engine, see get_random_engine(), so
+ * generating values never touches shared state. The engine satisfies
+ * UniformRandomBitGenerator and can be used with the standard
+ * distributions.
+ */
+class random_engine
+{
+public:
+  typedef uint64_t result_type;
+
+  explicit random_engine(uint64_t seed = 0) noexcept
+  {
+    this->seed(seed);
+  }
+
+  static constexpr result_type min()
+  {
+    return 0;
+  }
+  static constexpr result_type max()
+  {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  result_type operator()() noexcept
+  {
+    const uint64_t result = rotl(s[0] + s[3], 23) + s[0];
+    const uint64_t t      = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+  }
+
+  /* Initialize the state from a 64 bit seed using splitmix64 */
+  void seed(uint64_t seed) noexcept;
+
+  /* Advance the engine by 2^128 steps, used to create
+   * non-overlapping streams from the same seed */
+  void jump() noexcept;
+
+  void get_state(uint64_t out[4]) const noexcept
+  {
+    std::memcpy(out, s, sizeof(s));
+  }
+  void set_state(const uint64_t in[4]) noexcept
+  {
+    std::memcpy(s, in, sizeof(s));
+  }
+
+private:
+  static inline uint64_t rotl(const uint64_t x, int k) noexcept
+  {
+    return (x << k) | (x >> (64 - k));
+  }
+
+  uint64_t s[4];
+};
 
 template <typename T> T get_random();
 
+/**
+ * Fill n values of type T at once. This is much cheaper than calling
+ * get_random<T>() in a loop: the values are produced by a vectorizable
+ * generator seeded from the thread's engine, so the output is still
+ * reproducible. Values have the same range as get_random<T>().
+ * Supported types are int, float, double, char, unsigned char and bool.
+ */
+template <typename T> void get_random_fill(T *out, size_t n);
+
+#if __cplusplus >= 202002L // C++20
+template <typename T> void get_random_fill(std::span<T> out)
+{
+  get_random_fill<T>(out.data(), out.size());
+}
+#endif
+
+/* Fill n random bytes */
+void get_random_bytes(void *out, size_t n);
+void get_random_bytes(random_engine &engine, void *out, size_t n);
+
+class data_provider;
+
 #define FUZZME(fun_name, pretty_name)                                          \
-  void fun_name([[maybe_unused]] const std::string &test_name);                \
+  void fun_name([[maybe_unused]] const std::string &test_name,                 \
+                [[maybe_unused]] valfuzz::data_provider &provider);            \
   static struct fun_name##_register                                            \
   {                                                                            \
     fun_name##_register()                                                      \
@@ -37,22 +136,91 @@ template <typename T> T get_random();
       valfuzz::add_fuzz_test(pretty_name, fun_name);                           \
     }                                                                          \
   } fun_name##_register_instance;                                              \
-  void fun_name([[maybe_unused]] const std::string &test_name)
+  void fun_name([[maybe_unused]] const std::string &test_name,                 \
+                [[maybe_unused]] valfuzz::data_provider &provider)
+
+typedef std::function<void(const std::string &, data_provider &)>
+                                              fuzz_function;
+typedef std::pair<std::string, fuzz_function> fuzz_pair;
 
-typedef std::function<void(std::string)>        fuzz_function;
-typedef std::pair<std::string, fuzz_function>   fuzz_pair;
+/**
+ * A fuzz worker runs batches of FUZZ_BATCH_SIZE iterations of its
+ * targets, picked by a scheduler, so the hot loop never takes a lock.
+ * Every worker may run every target. The iteration counter is written
+ * only by its worker and published once per batch; workers are cache
+ * line aligned to avoid false sharing between the counters. Workers
+ * also keep a private copy of the corpus entries of their targets,
+ * refreshed once per batch.
+ *
+ * Every iteration is addressed by (worker, iteration): the engine is
+ * reseeded with iteration_seed() before it runs, so what it draws
+ * does not depend on the other workers or on thread scheduling. Only
+ * the corpus entries found by other workers, which guided fuzzing
+ * mutates, are shared.
+ */
+struct alignas(64) fuzz_worker
+{
+  long unsigned int              id = 0;
+  std::vector<size_t>            targets;  // indices in get_fuzzs()
+  std::atomic<long unsigned int> iterations = 0;
+  uint64_t next_iteration = 0;  // address of the next iteration
+
+  std::vector<std::vector<std::vector<uint8_t>>> corpus;  // by target
+  size_t corpus_seen = 0;  // entries of get_corpus() already copied
+
+  /* Published at the end of every batch, read by checkpoints */
+  std::mutex          checkpoint_mutex;
+  uint64_t            checkpoint_iteration = 0;
+  std::vector<double> energies;  // of the scheduler, by target
+};
+
+/**
+ * An input that reached new coverage
+ */
+struct corpus_entry
+{
+  size_t               target;  // index in get_fuzzs()
+  std::vector<uint8_t> data;
+};
 
-std::deque<fuzz_pair>&              get_fuzzs();
-long long unsigned int              get_num_fuzz_tests();
-std::atomic<long unsigned int>&     get_iterations();
-std::mt19937&                       get_random_engine();
-std::uniform_real_distribution<>&   get_uniform_distribution();
+std::deque<fuzz_pair>&                       get_fuzzs();
+long long unsigned int                       get_num_fuzz_tests();
+std::atomic<long unsigned int>&              get_iterations();
+std::vector<std::unique_ptr<fuzz_worker>>&   get_fuzz_workers();
+std::atomic<long unsigned int>&              get_fuzz_time();
+std::atomic<long unsigned int>&              get_fuzz_runs();
+std::deque<corpus_entry>&                    get_corpus();
+std::mutex&                                  get_corpus_mutex();
+long unsigned int                            get_corpus_size();
+random_engine&                               get_random_engine();
+std::uniform_real_distribution<>&            get_uniform_distribution();
+uint8_t*                                     get_fuzz_input_buffer();
 
-void increment_iterations();
-std::optional<fuzz_pair> pop_fuzz_or_null();
+void seed_random_engine(uint64_t stream);
+/* Seed of an iteration of a worker, derived from get_seed() */
+uint64_t iteration_seed(uint64_t worker, uint64_t iteration) noexcept;
+/* Budgets of a campaign, zero means no limit */
+void set_fuzz_time(long unsigned int seconds);
+void set_fuzz_runs(long unsigned int runs);
+/* Start counting get_fuzz_time() from now */
+void start_fuzz_budget();
+/* Stop the campaign after the current iterations, safe to call from
+ * a signal handler */
+void request_fuzz_stop() noexcept;
+/* Checked once per batch, so runs may exceed get_fuzz_runs() by a
+ * batch per worker. A stop request is also checked by every iteration
+ * of run_fuzz_batch() */
+bool fuzz_budget_exhausted();
+void add_iterations(long unsigned int n);
 void add_fuzz_test(const std::string &name, fuzz_function test);
+void add_to_corpus(const corpus_entry &entry);
 void run_one_fuzz(const std::string &name);
-void _run_fuzz_tests();
+void make_fuzz_workers(long unsigned int num_workers);
+void sync_worker_corpus(fuzz_worker &worker);
+/* Returns the number of new corpus entries and failures found, runs
+ * FUZZ_BATCH_SIZE iterations unless a stop is requested */
+size_t run_fuzz_batch(fuzz_worker &worker, size_t target, bool guided);
+void _run_fuzz_tests(fuzz_worker &worker);
 void run_fuzz_tests();
 
 } // namespace valfuzz
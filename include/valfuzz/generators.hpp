@@ -0,0 +1,205 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <valfuzz/fuzz.hpp>
+
+namespace valfuzz
+{
+
+/* Generators */
+
+#define GENERATE_SPECIAL_FLOAT_ODDS 16  // one value in 16 is special
+
+/**
+ * Typed values drawn from an engine, usually get_random_engine().
+ * Unlike get_random<T>(), which keeps its historical ranges,
+ * integers cover the full width of their type, bounded values are
+ * unbiased and floating point values are generated at the bit level,
+ * so NaNs, infinities, denormals and signed zeros all show up.
+ * Strings and containers are generated into a buffer owned by the
+ * caller: once it has grown to the maximum length, generating into it
+ * again never allocates.
+ */
+
+/* 64x64 -> 128 bit multiplication, returns the high half */
+inline uint64_t multiply_high(uint64_t a, uint64_t b, uint64_t &low) noexcept
+{
+  const uint64_t a_lo = a & 0xffffffff, a_hi = a >> 32;
+  const uint64_t b_lo = b & 0xffffffff, b_hi = b >> 32;
+  const uint64_t lo_lo = a_lo * b_lo;
+  const uint64_t hi_lo = a_hi * b_lo;
+  const uint64_t lo_hi = a_lo * b_hi;
+  const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+  low = (cross << 32) | (lo_lo & 0xffffffff);
+  return a_hi * b_hi + (hi_lo >> 32) + (cross >> 32);
+}
+
+/**
+ * A value in [0, range) without modulo bias, with Lemire's
+ * multiply-shift method: the division is only needed in the rare case
+ * the low half of the product falls in the biased zone.
+ */
+inline uint64_t generate_below(random_engine &engine, uint64_t range) noexcept
+{
+  if (range == 0)
+    return 0;
+  uint64_t low;
+  uint64_t high = multiply_high(engine(), range, low);
+  if (low < range)
+  {
+    const uint64_t threshold = (0 - range) % range;
+    while (low < threshold)
+    {
+      high = multiply_high(engine(), range, low);
+    }
+  }
+  return high;
+}
+
+/* A special floating point value, or one near an edge of the type */
+template <typename T> T generate_special_float(random_engine &engine) noexcept
+{
+  typedef std::numeric_limits<T> limits;
+  const T specials[] = {
+    T(0),
+    -T(0),
+    T(1),
+    T(-1),
+    limits::infinity(),
+    -limits::infinity(),
+    limits::quiet_NaN(),
+    -limits::quiet_NaN(),
+    limits::denorm_min(),
+    -limits::denorm_min(),
+    limits::min(),
+    -limits::min(),
+    limits::max(),
+    limits::lowest(),
+    limits::epsilon(),
+    T(1) + limits::epsilon(),
+  };
+  return specials[generate_below(engine, sizeof(specials) / sizeof(T))];
+}
+
+/* Integers of any width, bool and floating point values */
+template <typename T> T generate(random_engine &engine) noexcept
+{
+  static_assert(std::is_arithmetic_v<T>, "generate needs arithmetic types");
+  if constexpr (std::is_same_v<T, bool>)
+  {
+    return (engine() >> 63) != 0;
+  }
+  else if constexpr (std::is_integral_v<T>)
+  {
+    typedef std::make_unsigned_t<T> U;
+    return static_cast<T>(static_cast<U>(engine() >> (64 - 8 * sizeof(T))));
+  }
+  else
+  {
+    if (generate_below(engine, GENERATE_SPECIAL_FLOAT_ODDS) == 0)
+      return generate_special_float<T>(engine);
+    // every bit pattern, so every exponent is as likely
+    typedef std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t> bits_t;
+    static_assert(sizeof(T) == sizeof(bits_t), "unsupported float type");
+    const bits_t bits = static_cast<bits_t>(engine());
+    T value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+}
+
+/* A value in [min, max], unbiased for integers */
+template <typename T>
+T generate_in_range(random_engine &engine, T min, T max) noexcept
+{
+  static_assert(std::is_arithmetic_v<T>, "generate needs arithmetic types");
+  if (!(min < max))
+    return min;
+  if constexpr (std::is_floating_point_v<T>)
+  {
+    const T unit = static_cast<T>(engine() >> 11) * static_cast<T>(0x1.0p-53);
+    // max - min overflows to inf for ranges wider than half the type
+    const T value = min + unit * max - unit * min;
+    // rounding may land just outside the range
+    return value > max ? max : value;
+  }
+  else
+  {
+    typedef std::make_unsigned_t<T> U;
+    const uint64_t range =
+      static_cast<uint64_t>(static_cast<U>(static_cast<U>(max) -
+                                           static_cast<U>(min)));
+    const uint64_t offset = range == std::numeric_limits<uint64_t>::max()
+                              ? engine()
+                              : generate_below(engine, range + 1);
+    return static_cast<T>(static_cast<U>(static_cast<U>(min) + offset));
+  }
+}
+
+/* Fill n values with generate<T>() */
+template <typename T>
+void generate_fill(random_engine &engine, T *out, size_t n) noexcept
+{
+  if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>)
+  {
+    // every bit pattern is a valid integer
+    get_random_bytes(engine, out, n * sizeof(T));
+  }
+  else
+  {
+    for (size_t i = 0; i < n; i++)
+    {
+      out[i] = generate<T>(engine);
+    }
+  }
+}
+
+/* Replace out with at most max_len random bytes */
+void generate_string(random_engine &engine, std::string &out, size_t max_len);
+/* Replace out with at most max_len characters of alphabet */
+void generate_string(random_engine &engine, std::string &out, size_t max_len,
+                     std::string_view alphabet);
+
+/* Replace out with at most max_len values of generate<T>() */
+template <typename T>
+void generate_vector(random_engine &engine, std::vector<T> &out,
+                     size_t max_len)
+{
+  out.resize(generate_below(engine, max_len + 1));
+  if constexpr (std::is_same_v<T, bool>)
+  {
+    for (size_t i = 0; i < out.size(); i++)
+    {
+      out[i] = generate<bool>(engine);
+    }
+  }
+  else
+  {
+    generate_fill(engine, out.data(), out.size());
+  }
+}
+
+/* Replace out with at most max_len values of element(engine) */
+template <typename T, typename F>
+void generate_vector(random_engine &engine, std::vector<T> &out,
+                     size_t max_len, F &&element)
+{
+  out.resize(generate_below(engine, max_len + 1));
+  for (auto &&value : out)
+  {
+    value = element(engine);
+  }
+}
+
+} // namespace valfuzz
@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <valfuzz/data_provider.hpp>
+#include <valfuzz/fuzz.hpp>
+#include <valfuzz/reproducer.hpp>
+
+namespace valfuzz
+{
+
+/* Process isolation */
+
+#define ISOLATED_RING_SIZE (1 << 16)
+#define ISOLATED_NO_INPUT UINT32_MAX
+
+/**
+ * With --isolated every fuzz worker runs in a child process forked
+ * from the main one after the tests are registered and the corpus is
+ * loaded, so a crash in a target kills only that worker. Each child
+ * shares an isolated_slot with the parent: before running an input
+ * it records it there, and it sends the new corpus entries it finds
+ * through a single producer, single consumer ring. When a child dies
+ * the parent saves a reproducer of its last input and forks a new
+ * one, which starts from the parent's corpus. Crashes are bucketed by
+ * signal and by the hash of the backtrace the child records from its
+ * signal handler. The coverage map and the failure buckets are shared
+ * by all the processes. Linux only.
+ */
+struct alignas(64) isolated_slot
+{
+  std::atomic<long unsigned int> iterations;
+
+  /* Last input, either generated from the engine state or mutated */
+  uint64_t iteration;  // address in the worker
+  uint32_t target;
+  bool generated;
+  uint64_t engine_state[4];
+  uint32_t input_size;
+  uint8_t input[MAX_FUZZ_INPUT_SIZE];
+  /* Hash of the backtrace of a crash, written by the signal handler */
+  uint64_t backtrace;
+
+  /* Corpus entries, { target size data } padded to 8 bytes */
+  alignas(64) std::atomic<uint64_t> ring_head;
+  alignas(64) std::atomic<uint64_t> ring_tail;
+  uint8_t ring[ISOLATED_RING_SIZE];
+
+  /* The input will be generated by a provider from engine */
+  void record_generated(uint32_t input_target,
+                        const random_engine &engine) noexcept
+  {
+    target    = input_target;
+    generated = true;
+    engine.get_state(engine_state);
+  }
+  void record_input(uint32_t input_target, const random_engine &engine,
+                    const uint8_t *data, size_t size) noexcept
+  {
+    target     = input_target;
+    generated  = false;
+    input_size = (uint32_t) size;
+    engine.get_state(engine_state);
+    std::memcpy(input, data, size);
+  }
+
+  /* Child side, returns false if the ring is full */
+  bool push(const corpus_entry &entry) noexcept;
+  /* Parent side, returns false if the ring is empty */
+  bool pop(corpus_entry &entry);
+};
+
+bool&            get_is_isolated();
+isolated_slot*&  get_isolated_slot();
+
+void set_is_isolated(bool is_isolated);
+
+/* Rebuild the last input of a dead child */
+reproducer slot_reproducer(const isolated_slot &slot);
+void run_isolated_fuzz_tests(long unsigned int num_workers);
+
+} // namespace valfuzz
@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/* libFuzzer compatibility */
+
+#define LIBFUZZER_TARGET_NAME "LLVMFuzzerTestOneInput"
+
+/**
+ * Harnesses written for libFuzzer run unchanged: if the program
+ * defines LLVMFuzzerTestOneInput, it is registered as a fuzz test
+ * named LIBFUZZER_TARGET_NAME and gets the whole input of every
+ * iteration, so it runs on valfuzz's workers with its corpus, stats
+ * and reproducers. LLVMFuzzerInitialize, if defined, is called before
+ * the arguments are parsed. Both symbols are weak, programs that do
+ * not define them are not affected. The return value of the target is
+ * ignored.
+ */
+extern "C"
+{
+  __attribute__((weak)) int LLVMFuzzerTestOneInput(const uint8_t *data,
+                                                   size_t size);
+  __attribute__((weak)) int LLVMFuzzerInitialize(int *argc, char ***argv);
+}
+
+namespace valfuzz
+{
+
+/* Call LLVMFuzzerInitialize if the program defines it */
+void libfuzzer_initialize(int *argc, char ***argv);
+/* Register LLVMFuzzerTestOneInput if the program defines it, returns
+ * true if it did */
+bool register_libfuzzer_target();
+
+} // namespace valfuzz
@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#pragma once
+
+#include <atomic>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace valfuzz
+{
+
+/* Buffered output */
+
+/**
+ * Messages printed while tests and fuzz targets run, like failed
+ * assertions and verbose logs, go through a log_line instead of taking
+ * the stream mutex. The line is formatted into a buffer of the calling
+ * thread; when it is complete the buffer is pushed on a lock free
+ * list, and the first thread that finds the writer free writes
+ * everything pushed so far under the stream mutex. The others go on
+ * without waiting. Inside a group the lines of a thread to std::cout
+ * are held until the group ends, so run_test prints the verbose output
+ * of a test together. A line to std::cerr, like a failed assertion, is
+ * pushed at once with the lines held before it, so it is not lost if
+ * the test then crashes or hangs.
+ *
+ *   valfuzz::log_line(std::cerr) << "test: " << test_name << "\n";
+ *
+ * Output that was pushed while another thread was writing is written
+ * by the next line, by log_drain() at the end of the run, or at exit.
+ */
+struct log_batch
+{
+  log_batch                                      *next = nullptr;
+  std::vector<std::pair<std::ostream *, std::string>> segments;
+};
+
+class log_line
+{
+public:
+  explicit log_line(std::ostream &target);
+  ~log_line();
+  log_line(const log_line &)            = delete;
+  log_line &operator=(const log_line &) = delete;
+
+  template <typename T> log_line &operator<<(const T &value)
+  {
+    text << value;
+    return *this;
+  }
+  /* std::endl and std::flush, the batch is flushed when written */
+  log_line &operator<<(std::ostream &(*manipulator)(std::ostream &));
+
+private:
+  std::ostream      &target;
+  std::ostringstream &text;
+};
+
+/* Hold the lines of this thread until log_end_group() */
+void log_begin_group();
+/* Push the lines held since log_begin_group() */
+void log_end_group();
+/* Write everything pushed so far and the lines held by this thread,
+ * waiting for the writer */
+void log_drain();
+
+} // namespace valfuzz
@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <vector>
+#include <valfuzz/reproducer.hpp>
+
+namespace valfuzz
+{
+
+/* Minimizer */
+
+#define MINIMIZE_CANDIDATES_PER_THREAD 4
+
+/**
+ * Shrinks a failing input. Delta debugging first removes chunks of
+ * the input, halving their size whenever no chunk can go, down to
+ * single bytes; then every byte left is lowered, to zero if possible
+ * or else halved. The two passes repeat until neither makes the input
+ * smaller, so the result is 1-minimal: removing or lowering any single
+ * byte makes it pass.
+ *
+ * The candidates of a round are independent, so they are evaluated in
+ * parallel on up to num_threads threads of get_thread_pool().
+ * The first failing candidate in order wins, which keeps the result
+ * the same for any number of threads.
+ */
+typedef std::function<bool(const std::vector<uint8_t> &)> minimize_predicate;
+
+/* Removes [begin, end) from the input, or sets the byte at begin to
+ * value if value is not negative */
+struct minimize_candidate
+{
+  size_t begin;
+  size_t end;
+  int    value;
+};
+
+std::optional<std::filesystem::path>&   get_minimize_file();
+
+void set_minimize_file(const std::filesystem::path &file);
+
+void apply_candidate(const std::vector<uint8_t> &input,
+                     const minimize_candidate &candidate,
+                     std::vector<uint8_t> &out);
+/* data must fail, fails is called concurrently from up to num_threads
+ * threads of the pool. runs, if not null, is set to the number of calls */
+std::vector<uint8_t> minimize_input(std::vector<uint8_t> data,
+                                    const minimize_predicate &fails,
+                                    size_t num_threads,
+                                    size_t *runs = nullptr);
+/* Minimize the input of a reproducer and save the result in
+ * get_crash_dir() */
+void minimize_fuzz(const std::filesystem::path &path);
+
+} // namespace valfuzz
@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <valfuzz/fuzz.hpp>
+
+namespace valfuzz
+{
+
+/* Mutations */
+
+#define MAX_MUTATION_STACK 8
+#define MAX_DICTIONARY_SIZE 1024
+
+enum class mutation
+{
+  bit_flip,
+  byte_flip,
+  interesting_value,
+  arithmetic,
+  insert_block,
+  delete_block,
+  duplicate_block,
+  splice,
+  dictionary,
+  count
+};
+
+std::string mutation_name(mutation m);
+
+class mutator;
+/* The calling thread's mutator, drawing from get_random_engine() */
+mutator& get_thread_mutator();
+
+/**
+ * Mutates fuzz inputs in place. Every call to mutate() applies a
+ * stack of operators; when the result turns out to be interesting the
+ * caller calls reward() and the operators that produced it are picked
+ * more often, proportionally to their success rate. A mutator is not
+ * thread safe, every fuzz worker has its own.
+ */
+class mutator
+{
+public:
+  explicit mutator(random_engine &engine) noexcept : engine(engine)
+  {
+  }
+
+  /* Apply a stack of random mutations, other is used to splice and
+   * may be null. The result is at most max_size bytes */
+  void mutate(std::vector<uint8_t> &data, size_t max_size,
+              const std::vector<uint8_t> *other = nullptr);
+  /* Apply a single operator, returns false if it could not be applied */
+  bool mutate_with(mutation m, std::vector<uint8_t> &data, size_t max_size,
+                   const std::vector<uint8_t> *other = nullptr);
+  /* The last mutate() produced an interesting input */
+  void reward();
+
+  void add_token(const uint8_t *token, size_t size);
+  size_t dictionary_size() const noexcept
+  {
+    return dictionary.size();
+  }
+
+  long unsigned int uses(mutation m) const noexcept
+  {
+    return operator_uses[(size_t) m];
+  }
+  long unsigned int successes(mutation m) const noexcept
+  {
+    return operator_successes[(size_t) m];
+  }
+
+private:
+  mutation pick_operator();
+  uint64_t below(uint64_t n)
+  {
+    return n == 0 ? 0 : engine() % n;
+  }
+
+  random_engine &engine;
+  std::vector<std::vector<uint8_t>> dictionary;
+
+  long unsigned int operator_uses[(size_t) mutation::count]      = {};
+  long unsigned int operator_successes[(size_t) mutation::count] = {};
+  long unsigned int total_uses                                   = 0;
+
+  mutation last_stack[MAX_MUTATION_STACK];
+  size_t last_stack_size = 0;
+};
+
+} // namespace valfuzz
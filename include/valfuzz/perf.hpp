@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <valfuzz/fuzz.hpp>
+
+namespace valfuzz
+{
+
+/* Performance fuzzing */
+
+#define PERF_CORPUS_GAIN 1.1  // a slower input must cost 10% more
+#define PERF_CALIBRATION_MS 10
+
+/**
+ * With --perf the fuzz loop hunts for slow inputs too. Every execution
+ * of a target is measured with a metric: time, read from the time
+ * stamp counter on x86 and from steady_clock elsewhere; edges, the
+ * number of instrumented edges it executed, which does not depend on
+ * the load of the machine; or instructions, counted by the CPU through
+ * perf_event_open (Linux only).
+ *
+ * An input that costs PERF_CORPUS_GAIN times more than the slowest
+ * input of its target so far becomes the new slowest one and is added
+ * to the corpus, so that the mutator climbs towards slower inputs.
+ * Separately, every input whose cost is over the threshold is saved,
+ * with its cost, as a slow-<hash> reproducer in the crash directory;
+ * an input already saved is not written again.
+ */
+enum class perf_metric
+{
+  none,
+  time,
+  edges,
+  instructions,
+};
+
+std::atomic<perf_metric>&   get_perf_metric();
+std::atomic<double>&        get_slow_input_threshold();
+
+void set_perf_metric(perf_metric metric);
+/* Milliseconds for time, edges or instructions otherwise. Zero saves
+ * no input */
+void set_slow_input_threshold(double threshold);
+std::optional<perf_metric> parse_perf_metric(const std::string &name);
+const char* perf_metric_unit(perf_metric metric);
+
+/* Check that the metric can be read and calibrate the clock, falls
+ * back to time if the CPU counters are not available */
+void perf_init();
+/* Forget the slowest inputs */
+void perf_reset(size_t num_targets);
+/* Reading of the metric on this thread, the cost of an execution is
+ * the difference of the readings after and before it */
+uint64_t perf_read(perf_metric metric) noexcept;
+/* The cost between two readings, nullopt if either reading failed,
+ * which reads as 0, or the metric went backwards */
+std::optional<uint64_t> perf_measure(uint64_t started,
+                                     uint64_t ended) noexcept;
+/* A cost in the unit of the metric */
+double perf_cost(perf_metric metric, uint64_t cost) noexcept;
+/* True if the input is the new slowest of its target */
+bool perf_update(size_t target, uint64_t cost) noexcept;
+uint64_t perf_slowest(size_t target) noexcept;
+/* True if the cost is over the slow input threshold */
+bool perf_is_slow(perf_metric metric, uint64_t cost) noexcept;
+/* Save the input if its cost is over the threshold and it was not
+ * saved yet */
+void record_slow_input(size_t target, uint64_t cost,
+                       const random_engine &state, const uint8_t *data,
+                       size_t size);
+
+} // namespace valfuzz
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+#include <valfuzz/fuzz.hpp>
+
+namespace valfuzz
+{
+
+/* Reproducers */
+
+/**
+ * Everything needed to run a failing fuzz iteration again: the
+ * target, the input it read from its provider and the state of the
+ * engine, so that get_random<T>() returns the same values too.
+ *
+ * File layout, a text header followed by the raw input:
+ *   valfuzz reproducer 1
+ *   target: <name>
+ *   engine: <4 hex words>
+ *   cost: <cost of a slow input>    (optional)
+ *   size: <input size>
+ *   <empty line>
+ *   <input>
+ */
+struct reproducer
+{
+  std::string          target;
+  random_engine        engine;
+  std::vector<uint8_t> data;
+  std::string          cost = "";  // of a slow input, e.g. "12.5 ms"
+};
+
+std::filesystem::path&   get_crash_dir();
+std::optional<std::filesystem::path>&   get_replay_file();
+
+void set_crash_dir(const std::filesystem::path &dir);
+void set_replay_file(const std::filesystem::path &file);
+
+/* Write a reproducer atomically, returns false on error */
+bool write_reproducer(const std::filesystem::path &path,
+                      const reproducer &repro);
+std::optional<reproducer> read_reproducer(const std::filesystem::path &path);
+/* The path of a reproducer in get_crash_dir(), named after its
+ * target and input */
+std::filesystem::path reproducer_path(const reproducer &repro,
+                                      const std::string &prefix = "crash");
+/* Save a reproducer at reproducer_path() and return its path */
+std::filesystem::path save_reproducer(const reproducer &repro,
+                                      const std::string &prefix = "crash");
+/* Save a reproducer the first time a failure bucket is hit, state is
+ * the engine right before the target ran. Returns false if the bucket
+ * already had one */
+bool record_failure(size_t target, uint64_t signature,
+                    const random_engine &state, const uint8_t *data,
+                    size_t size);
+/* A failing target may narrow the input to save down to the part
+ * that failed, the fuzz loop saves it instead of the whole input */
+void set_failing_input(const random_engine &state, const uint8_t *data,
+                       size_t size);
+std::optional<reproducer>& get_thread_failing_input();
+
+/* Run the target of a reproducer once on its input, in this thread */
+void run_reproducer(const reproducer &repro);
+void replay_fuzz(const std::filesystem::path &path);
+
+} // namespace valfuzz
@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <valfuzz/fuzz.hpp>
+
+namespace valfuzz
+{
+
+/* Scheduling */
+
+#define SCHEDULER_MIN_ENERGY 1.0
+#define SCHEDULER_MAX_ENERGY 64.0
+#define SCHEDULER_DECAY 0.95
+
+/**
+ * Picks the target of the next batch of a fuzz worker. Every target
+ * has an energy and is picked with a probability proportional to it.
+ * Targets start at SCHEDULER_MAX_ENERGY so that all of them are
+ * explored; a batch that finds new coverage or a new failure doubles
+ * the energy of its target, a batch that finds nothing multiplies it
+ * by SCHEDULER_DECAY. Saturated targets sink to SCHEDULER_MIN_ENERGY
+ * and keep running, but only rarely. A scheduler is not thread safe,
+ * every worker has its own and draws from its own engine, so it does
+ * not change the reproducibility of a worker's stream.
+ */
+class scheduler
+{
+public:
+  explicit scheduler(size_t num_targets)
+    : energies(num_targets, SCHEDULER_MAX_ENERGY),
+      total_energy(SCHEDULER_MAX_ENERGY * (double) num_targets)
+  {
+  }
+
+  /* Index of the next target, num_targets must not be zero */
+  size_t next(random_engine &engine) const noexcept;
+  /* A batch of target found finds new inputs or failures */
+  void update(size_t target, size_t finds) noexcept;
+
+  double energy(size_t target) const noexcept
+  {
+    return energies[target];
+  }
+  /* Restore the energy of a target, e.g. from a checkpoint */
+  void set_energy(size_t target, double energy) noexcept
+  {
+    energy = std::min(std::max(energy, SCHEDULER_MIN_ENERGY),
+                      SCHEDULER_MAX_ENERGY);
+    total_energy += energy - energies[target];
+    energies[target] = energy;
+  }
+
+private:
+  std::vector<double> energies;
+  double total_energy;
+};
+
+} // namespace valfuzz
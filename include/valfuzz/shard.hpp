@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace valfuzz
+{
+
+/* Test sharding and history */
+
+#define TIMINGS_HEADER "valfuzz timings 2"
+#define TIMINGS_HEADER_V1 "valfuzz timings 1"
+#define TIMINGS_NEVER_FAILED ((long unsigned int) -1)
+#define TIMINGS_RECENT_RUNS 3
+
+/**
+ * --shard-index i --shard-count n runs only the tests of shard i out
+ * of n, so one test binary can be spread over processes or machines.
+ * Every process computes the same partition: the tests are sorted
+ * longest first, by the durations of --timings <file> if given, then
+ * by name, and each one goes to the shard with the least work so far.
+ * Tests missing from the file count as the mean of the others; with no
+ * file at all every test weighs the same and the shards get the same
+ * number of tests.
+ *
+ * The same file is the history of the tests: their wall time and the
+ * number of runs since they last failed. Tests that failed in the last
+ * TIMINGS_RECENT_RUNS runs are started first, most recent first, then
+ * the others longest first, so failures show up early and a long test
+ * does not start last while the other threads are idle.
+ *
+ * After the tests ran the tests of this run are written to
+ * --timings-out <file>, or back to the --timings file when the run is
+ * not sharded. A sharded run never rewrites its input, so shards that
+ * start at different times still compute the same partition. Each line
+ * is "<seconds> <runs since failure> <name>", with "-" for a test that
+ * never failed, and a later line wins over an earlier one for the same
+ * test, so the files written by the shards merge by concatenating them.
+ */
+struct test_record
+{
+  double            seconds       = 0;
+  long unsigned int since_failure = TIMINGS_NEVER_FAILED;
+};
+
+typedef std::unordered_map<std::string, test_record> test_timings;
+
+std::atomic<long unsigned int>&         get_shard_index();
+std::atomic<long unsigned int>&         get_shard_count();
+std::optional<std::filesystem::path>&   get_timings_file();
+std::optional<std::filesystem::path>&   get_timings_out_file();
+
+void set_shard_index(long unsigned int shard_index);
+void set_shard_count(long unsigned int shard_count);
+void set_timings_file(const std::filesystem::path &timings_file);
+void set_timings_out_file(const std::filesystem::path &timings_out_file);
+
+test_timings read_test_timings(const std::filesystem::path &path);
+bool write_test_timings(const std::filesystem::path &path,
+                        const test_timings &timings);
+/* The shard of each test, in the order of names */
+std::vector<size_t> assign_shards(const std::vector<std::string> &names,
+                                  size_t shard_count,
+                                  const test_timings &timings);
+/* Keep only the registered tests of get_shard_index() */
+void shard_tests();
+/* Permutation of names that runs recently failed tests first and then
+ * the others longest first */
+std::vector<size_t> history_order(const std::vector<std::string> &names,
+                                  const test_timings &timings);
+/* Sort the registered tests by history_order(), if a timings file was
+ * given */
+void order_tests();
+/* The file the timings of this run are written to, if any */
+std::optional<std::filesystem::path> timings_output_file();
+/* Remember the wall time and result of a test, if the timings of this
+ * run are written */
+void record_test_run(const std::string &name, double seconds, bool failed);
+/* Write the recorded tests to timings_output_file() */
+void save_test_timings();
+
+} // namespace valfuzz
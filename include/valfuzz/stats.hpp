@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+namespace valfuzz
+{
+
+/* Fuzz statistics */
+
+#define STATS_DEFAULT_INTERVAL 5  // seconds
+
+/**
+ * Execution counters of the fuzz workers, one row per worker with
+ * one counter per target. A row is written only by its worker, once
+ * per batch, and rows are cache line aligned so workers never share
+ * a line. The counters live in shared memory on Linux, so the workers
+ * of --isolated update them from their own process.
+ */
+class fuzz_stats
+{
+public:
+  fuzz_stats() = default;
+  fuzz_stats(const fuzz_stats &)            = delete;
+  fuzz_stats &operator=(const fuzz_stats &) = delete;
+  ~fuzz_stats();
+
+  /* Drop all the counters and make new ones, set to zero */
+  void reset(size_t num_workers, size_t num_targets);
+
+  void add(size_t worker, size_t target, uint64_t n) noexcept
+  {
+    std::atomic<uint64_t> &counter = counters[worker * stride + target];
+    counter.store(counter.load(std::memory_order_relaxed) + n,
+                  std::memory_order_relaxed);
+  }
+  uint64_t get(size_t worker, size_t target) const noexcept
+  {
+    return counters[worker * stride + target].load(std::memory_order_relaxed);
+  }
+
+  size_t get_num_workers() const noexcept
+  {
+    return num_workers;
+  }
+  size_t get_num_targets() const noexcept
+  {
+    return num_targets;
+  }
+
+private:
+  void release() noexcept;
+
+  std::atomic<uint64_t> *counters = nullptr;
+  size_t num_workers = 0;
+  size_t num_targets = 0;
+  size_t stride      = 0;  // counters per row
+  size_t size        = 0;  // bytes
+  bool shared        = false;
+};
+
+/**
+ * The state of a campaign at some time, rates are computed between
+ * two snapshots
+ */
+struct stats_snapshot
+{
+  double                seconds = 0;  // since fuzzing started
+  uint64_t              execs   = 0;
+  std::vector<uint64_t> target_execs;  // by index in get_fuzzs()
+  std::vector<uint64_t> worker_execs;  // by worker id
+  uint64_t              edges       = 0;
+  uint64_t              corpus      = 0;
+  uint64_t              peak_rss_kb = 0;
+};
+
+fuzz_stats&                             get_fuzz_stats();
+std::atomic<long unsigned int>&         get_stats_interval();
+std::optional<std::filesystem::path>&   get_stats_file();
+
+void set_stats_interval(long unsigned int seconds);
+void set_stats_file(const std::filesystem::path &file);
+
+/* Peak resident set size of this process and its children, in KiB */
+uint64_t get_peak_rss_kb();
+stats_snapshot take_stats_snapshot(const fuzz_stats &stats, double seconds);
+
+/* One summary line, with a line per target and per worker if verbose */
+void print_stats(std::ostream &out, const stats_snapshot &now,
+                 const stats_snapshot &before, bool verbose);
+/* The same report as a JSON object */
+void write_stats(std::ostream &out, const stats_snapshot &now,
+                 const stats_snapshot &before);
+
+/**
+ * Prints a report every get_stats_interval() seconds, and saves it to
+ * get_stats_file() if set. The fuzz loop never reports by itself:
+ * either the stats thread polls the reporter, or the parent of
+ * isolated workers does it from its own loop.
+ */
+class stats_reporter
+{
+public:
+  stats_reporter();
+
+  /* Report if the interval has passed since the last report */
+  void poll();
+  void report();
+
+private:
+  double elapsed() const;
+
+  std::chrono::steady_clock::time_point start;
+  stats_snapshot last;
+};
+
+void start_stats_thread();
+/* Stop the thread after a last report */
+void stop_stats_thread();
+
+} // namespace valfuzz
@@ -16,70 +16,86 @@
 #include <thread>
 #include <tuple>
 #include <valfuzz/common.hpp>
+#include <valfuzz/failures.hpp>
+#include <valfuzz/log.hpp>
 
 /* Assertions */
 
 #define ASSERT(cond)                                                           \
   if (!(cond))                                                                 \
   {                                                                            \
-    valfuzz::set_has_failed_once(true);                                        \
-    std::lock_guard<std::mutex> lock(valfuzz::get_stream_mutex());             \
-    std::cerr << "test: " << test_name << ", line: " << __LINE__ << ", ";      \
-    std::cerr << "Assertion failed: " << #cond << std::endl;                   \
+    if (valfuzz::assertion_failed(test_name, __FILE__, __LINE__))              \
+    {                                                                          \
+      valfuzz::log_line(std::cerr)                                             \
+        << "test: " << test_name << ", line: " << __LINE__ << ", "             \
+        << "Assertion failed: " << #cond << "\n";                              \
+    }                                                                          \
   }
 
 #define ASSERT_EQ(a, b)                                                        \
   if ((a) != (b))                                                              \
   {                                                                            \
-    valfuzz::set_has_failed_once(true);                                        \
-    std::lock_guard<std::mutex> lock(valfuzz::get_stream_mutex());             \
-    std::cerr << "test: " << test_name << ", line: " << __LINE__ << ", ";      \
-    std::cerr << "Assertion failed: " << #a << " != " << #b << std::endl;      \
+    if (valfuzz::assertion_failed(test_name, __FILE__, __LINE__))              \
+    {                                                                          \
+      valfuzz::log_line(std::cerr)                                             \
+        << "test: " << test_name << ", line: " << __LINE__ << ", "             \
+        << "Assertion failed: " << #a << " != " << #b << "\n";                 \
+    }                                                                          \
   }
 
 #define ASSERT_NE(a, b)                                                        \
   if ((a) == (b))                                                              \
   {                                                                            \
-    valfuzz::set_has_failed_once(true);                                        \
-    std::lock_guard<std::mutex> lock(valfuzz::get_stream_mutex());             \
-    std::cerr << "test: " << test_name << ", line: " << __LINE__ << ", ";      \
-    std::cerr << "Assertion failed: " << #a << " == " << #b << std::endl;      \
+    if (valfuzz::assertion_failed(test_name, __FILE__, __LINE__))              \
+    {                                                                          \
+      valfuzz::log_line(std::cerr)                                             \
+        << "test: " << test_name << ", line: " << __LINE__ << ", "             \
+        << "Assertion failed: " << #a << " == " << #b << "\n";                 \
+    }                                                                          \
   }
 
 #define ASSERT_LT(a, b)                                                        \
   if ((a) >= (b))                                                              \
   {                                                                            \
-    valfuzz::set_has_failed_once(true);                                        \
-    std::lock_guard<std::mutex> lock(valfuzz::get_stream_mutex());             \
-    std::cerr << "test: " << test_name << ", line: " << __LINE__ << ", ";      \
-    std::cerr << "Assertion failed: " << #a << " < " << #b << std::endl;       \
+    if (valfuzz::assertion_failed(test_name, __FILE__, __LINE__))              \
+    {                                                                          \
+      valfuzz::log_line(std::cerr)                                             \
+        << "test: " << test_name << ", line: " << __LINE__ << ", "             \
+        << "Assertion failed: " << #a << " < " << #b << "\n";                  \
+    }                                                                          \
   }
 
 #define ASSERT_LE(a, b)                                                        \
   if ((a) > (b))                                                               \
   {                                                                            \
-    valfuzz::set_has_failed_once(true);                                        \
-    std::lock_guard<std::mutex> lock(valfuzz::get_stream_mutex());             \
-    std::cerr << "test: " << test_name << ", line: " << __LINE__ << ", ";      \
-    std::cerr << "Assertion failed: " << #a << " <= " << #b << std::endl;      \
+    if (valfuzz::assertion_failed(test_name, __FILE__, __LINE__))              \
+    {                                                                          \
+      valfuzz::log_line(std::cerr)                                             \
+        << "test: " << test_name << ", line: " << __LINE__ << ", "             \
+        << "Assertion failed: " << #a << " <= " << #b << "\n";                 \
+    }                                                                          \
   }
 
 #define ASSERT_GT(a, b)                                                        \
   if ((a) <= (b))                                                              \
   {                                                                            \
-    valfuzz::set_has_failed_once(true);                                        \
-    std::lock_guard<std::mutex> lock(valfuzz::get_stream_mutex());             \
-    std::cerr << "test: " << test_name << ", line: " << __LINE__ << ", ";      \
-    std::cerr << "Assertion failed: " << #a << " > " << #b << std::endl;       \
+    if (valfuzz::assertion_failed(test_name, __FILE__, __LINE__))              \
+    {                                                                          \
+      valfuzz::log_line(std::cerr)                                             \
+        << "test: " << test_name << ", line: " << __LINE__ << ", "             \
+        << "Assertion failed: " << #a << " > " << #b << "\n";                  \
+    }                                                                          \
   }
 
 #define ASSERT_GE(a, b)                                                        \
   if ((a) < (b))                                                               \
   {                                                                            \
-    valfuzz::set_has_failed_once(true);                                        \
-    std::lock_guard<std::mutex> lock(valfuzz::get_stream_mutex());             \
-    std::cerr << "test: " << test_name << ", line: " << __LINE__ << ", ";      \
-    std::cerr << "Assertion failed: " << #a << " >= " << #b << std::endl;      \
+    if (valfuzz::assertion_failed(test_name, __FILE__, __LINE__))              \
+    {                                                                          \
+      valfuzz::log_line(std::cerr)                                             \
+        << "test: " << test_name << ", line: " << __LINE__ << ", "             \
+        << "Assertion failed: " << #a << " >= " << #b << "\n";                 \
+    }                                                                          \
   }
 
 #define ASSERT_THROW(expr, exception)                                          \
@@ -95,10 +111,12 @@
     }                                                                          \
     if (!exception_thrown)                                                     \
     {                                                                          \
-      valfuzz::set_has_failed_once(true);                                      \
-      std::lock_guard<std::mutex> lock(valfuzz::get_stream_mutex());           \
-      std::cerr << "test: " << test_name << ", line: " << __LINE__ << ", ";    \
-      std::cerr << "Exception not thrown: " << #exception << std::endl;        \
+      if (valfuzz::assertion_failed(test_name, __FILE__, __LINE__))            \
+      {                                                                        \
+        valfuzz::log_line(std::cerr)                                           \
+          << "test: " << test_name << ", line: " << __LINE__ << ", "           \
+          << "Exception not thrown: " << #exception << "\n";                   \
+      }                                                                        \
     }                                                                          \
   }
 
@@ -110,10 +128,12 @@
     }                                                                          \
     catch (...)                                                                \
     {                                                                          \
-      valfuzz::set_has_failed_once(true);                                      \
-      std::lock_guard<std::mutex> lock(valfuzz::get_stream_mutex());           \
-      std::cerr << "test: " << test_name << ", line: " << __LINE__ << ", ";    \
-      std::cerr << "Exception thrown" << std::endl;                            \
+      if (valfuzz::assertion_failed(test_name, __FILE__, __LINE__))            \
+      {                                                                        \
+        valfuzz::log_line(std::cerr)                                           \
+          << "test: " << test_name << ", line: " << __LINE__ << ", "           \
+          << "Exception thrown" << "\n";                                       \
+      }                                                                        \
     }                                                                          \
   }
 
@@ -126,6 +146,7 @@ std::deque<valfuzz::test_pair>&  get_tests();
 std::mutex&                      get_test_mutex();
 long long unsigned int           get_num_tests();
 std::atomic<bool>&               get_has_failed_once();
+bool&                            get_thread_has_failed();
 
 std::function<void()> &get_function_execute_before();
 std::function<void()> &get_function_execute_after();
@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace valfuzz
+{
+
+/* CPU topology */
+
+#define TOPOLOGY_SYSFS_ROOT "/sys/devices/system"
+#define TOPOLOGY_DEFAULT_LINE_SIZE 64
+
+/**
+ * The CPUs, caches and NUMA nodes of the machine, read from sysfs once
+ * by get_cpu_topology() and cached. logical_cpus counts the CPUs this
+ * process may run on, so it follows taskset and container limits;
+ * physical_cores counts the distinct cores among them, without the SMT
+ * siblings. The caches are those of the first CPU. Where sysfs is not
+ * available every count falls back to std::thread::hardware_concurrency
+ * and there are no caches.
+ */
+struct cache_info
+{
+  int         level     = 0;
+  std::string type;           // Data, Instruction or Unified
+  size_t      size      = 0;  // bytes
+  size_t      line_size = 0;  // bytes
+  size_t      shared_by = 1;  // logical CPUs
+};
+
+struct cpu_topology
+{
+  size_t                  logical_cpus   = 1;
+  size_t                  physical_cores = 1;
+  size_t                  packages       = 1;
+  size_t                  numa_nodes     = 1;
+  std::vector<cache_info> caches;
+
+  /* Size of the data or unified cache of a level, 0 if unknown */
+  size_t cache_size(int level) const noexcept;
+  /* Size of the data or unified cache of the last level, 0 if unknown */
+  size_t last_level_cache_size() const noexcept;
+  size_t cache_line_size() const noexcept;
+};
+
+/* Parse a sysfs tree, with cpu/ and node/ under root. cpus restricts
+ * the CPUs counted, all the online ones if empty */
+cpu_topology read_cpu_topology(const std::filesystem::path &root,
+                               const std::vector<size_t> &cpus = {});
+/* Parse a cpu list like "0-3,8,10-11" */
+std::vector<size_t> parse_cpu_list(const std::string &list);
+/* Parse a size like "32K", "2048K" or "8M" */
+size_t parse_cache_size(const std::string &size);
+
+const cpu_topology& get_cpu_topology();
+
+} // namespace valfuzz
@@ -16,10 +16,26 @@
 #include <thread>
 #include <tuple>
 #include <valfuzz/benchmark.hpp>
+#include <valfuzz/checkpoint.hpp>
 #include <valfuzz/common.hpp>
+#include <valfuzz/corpus.hpp>
+#include <valfuzz/coverage.hpp>
+#include <valfuzz/data_provider.hpp>
+#include <valfuzz/diff.hpp>
+#include <valfuzz/failures.hpp>
 #include <valfuzz/fuzz.hpp>
+#include <valfuzz/generators.hpp>
+#include <valfuzz/isolation.hpp>
+#include <valfuzz/libfuzzer.hpp>
+#include <valfuzz/log.hpp>
+#include <valfuzz/minimizer.hpp>
+#include <valfuzz/perf.hpp>
 #include <valfuzz/reporter.hpp>
+#include <valfuzz/reproducer.hpp>
+#include <valfuzz/shard.hpp>
+#include <valfuzz/stats.hpp>
 #include <valfuzz/test.hpp>
+#include <valfuzz/topology.hpp>
 
 namespace valfuzz
 {
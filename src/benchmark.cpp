@@ -4,6 +4,7 @@
 // Github:  @San7o
 
 #include <valfuzz/benchmark.hpp>
+#include <valfuzz/topology.hpp>
 
 namespace valfuzz
 {
@@ -18,46 +19,10 @@ std::atomic<bool> &get_save_to_file()
   return save_to_file;
 }
 
-#if defined(__linux__)
 unsigned long get_cache_l3_size()
 {
-  std::ifstream file("/sys/devices/system/cpu/cpu0/cache/index2/size");
-  std::string size_str;
-  if (file.is_open())
-  {
-    std::getline(file, size_str);
-    file.close();
-  }
-
-  char unit = size_str.back();
-  size_str.pop_back();
-  unsigned long cache_size = std::stoul(size_str);
-
-  switch (unit)
-  {
-  case 'K':
-    cache_size *= 1024;
-    break;
-  case 'M':
-    cache_size *= 1024 * 1024;
-    break;
-  default:
-    break;
-  }
-
-  return cache_size;
-}
-#elif defined(_WIN32) || defined(_WIN64)
-unsigned long get_cache_l3_size()
-{
-  return 0;
+  return get_cpu_topology().last_level_cache_size();
 }
-#else
-unsigned long get_cache_l3_size()
-{
-  return 0;
-}
-#endif
 
 bool &get_do_benchmarks()
 {
@@ -161,7 +126,8 @@ void set_one_benchmark(const std::string &one_benchmark)
 
 void run_benchmarks()
 {
-  const size_t bigger_than_cachesize = get_cache_l3_size() * 2;
+  // twice the last level cache, in longs
+  const size_t bigger_than_cachesize = get_cache_l3_size() * 2 / sizeof(long);
   if (bigger_than_cachesize == 0)
     return;
   long *p;
@@ -172,18 +138,27 @@ void run_benchmarks()
   }
   for (auto &benchmark : get_benchmarks())
   {
-    // flush cache
-    for (size_t i = 0; i < bigger_than_cachesize; i++)
-    {
-      p[i] = std::rand();
-    }
-
     if (get_run_one_benchmark())
     {
       if (benchmark.first != get_one_benchmark())
         continue;
     }
 
+    // flush cache, the workers of the pool sleep while the benchmark
+    // runs
+    const long value = std::rand();
+    auto flush       = [p, value](size_t begin, size_t end)
+    {
+      for (size_t i = begin; i < end; i++)
+      {
+        p[i] = value + (long) i;
+      }
+    };
+    if (get_is_threaded())
+      get_thread_pool().parallel_for(bigger_than_cachesize, flush);
+    else
+      flush(0, bigger_than_cachesize);
+
     if (get_verbose())
     {
       std::lock_guard<std::mutex> lock(get_stream_mutex());
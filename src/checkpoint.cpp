@@ -0,0 +1,365 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <csignal>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <unordered_map>
+#include <valfuzz/checkpoint.hpp>
+#include <valfuzz/corpus.hpp>
+#include <valfuzz/coverage.hpp>
+#include <valfuzz/scheduler.hpp>
+#include <valfuzz/stats.hpp>
+
+namespace valfuzz
+{
+
+std::optional<std::filesystem::path> &get_checkpoint_dir()
+{
+  static std::optional<std::filesystem::path> checkpoint_dir = std::nullopt;
+  return checkpoint_dir;
+}
+
+std::atomic<long unsigned int> &get_checkpoint_interval()
+{
+#if __cplusplus >= 202002L // C++20
+  constinit
+#endif
+    static std::atomic<long unsigned int>
+      checkpoint_interval = CHECKPOINT_DEFAULT_INTERVAL;
+  return checkpoint_interval;
+}
+
+std::optional<std::filesystem::path> &get_resume_dir()
+{
+  static std::optional<std::filesystem::path> resume_dir = std::nullopt;
+  return resume_dir;
+}
+
+void set_checkpoint_dir(const std::filesystem::path &dir)
+{
+  auto &checkpoint_dir = get_checkpoint_dir();
+  checkpoint_dir       = dir;
+}
+
+void set_checkpoint_interval(long unsigned int seconds)
+{
+  auto &checkpoint_interval = get_checkpoint_interval();
+  checkpoint_interval       = seconds;
+}
+
+void set_resume_dir(const std::filesystem::path &dir)
+{
+  auto &resume_dir = get_resume_dir();
+  resume_dir       = dir;
+  set_checkpoint_dir(dir);
+}
+
+bool write_checkpoint_state(const std::filesystem::path &path,
+                            const checkpoint &state)
+{
+  std::ostringstream out;
+  out << std::setprecision(std::numeric_limits<double>::max_digits10);
+  out << CHECKPOINT_HEADER << "\n";
+  out << "seed: " << state.seed << "\n";
+  out << "iterations: " << state.iterations << "\n";
+  out << "targets: " << state.targets.size() << "\n";
+  for (const auto &target : state.targets)
+  {
+    out << "target: " << target << "\n";
+  }
+  out << "workers: " << state.workers.size() << "\n";
+  for (const auto &worker : state.workers)
+  {
+    out << "worker: " << worker.next_iteration;
+    for (size_t t = 0; t < state.targets.size(); t++)
+    {
+      out << " " << (t < worker.execs.size() ? worker.execs[t] : 0);
+    }
+    for (size_t t = 0; t < state.targets.size(); t++)
+    {
+      out << " "
+          << (t < worker.energies.size() ? worker.energies[t]
+                                         : SCHEDULER_MAX_ENERGY);
+    }
+    out << "\n";
+  }
+
+  std::string content = out.str();
+  return write_file_atomically(
+    path, reinterpret_cast<const uint8_t *>(content.data()), content.size());
+}
+
+/* The value of a "name: value" line */
+static std::optional<std::string> read_field(std::istream &in,
+                                             const std::string &name)
+{
+  std::string line;
+  if (!std::getline(in, line) || line.rfind(name + ": ", 0) != 0)
+    return std::nullopt;
+  return line.substr(name.size() + 2);
+}
+
+std::optional<checkpoint>
+read_checkpoint_state(const std::filesystem::path &path)
+{
+  std::ifstream file(path);
+  if (!file.is_open())
+    return std::nullopt;
+  std::string line;
+  if (!std::getline(file, line) || line != CHECKPOINT_HEADER)
+    return std::nullopt;
+
+  checkpoint state;
+  try
+  {
+    auto seed       = read_field(file, "seed");
+    auto iterations = read_field(file, "iterations");
+    auto targets    = read_field(file, "targets");
+    if (!seed || !iterations || !targets)
+      return std::nullopt;
+    state.seed       = std::stoull(seed.value());
+    state.iterations = std::stoull(iterations.value());
+    const size_t num_targets = std::stoul(targets.value());
+    for (size_t t = 0; t < num_targets; t++)
+    {
+      auto target = read_field(file, "target");
+      if (!target)
+        return std::nullopt;
+      state.targets.push_back(target.value());
+    }
+
+    auto workers = read_field(file, "workers");
+    if (!workers)
+      return std::nullopt;
+    const size_t num_workers = std::stoul(workers.value());
+    for (size_t w = 0; w < num_workers; w++)
+    {
+      auto fields = read_field(file, "worker");
+      if (!fields)
+        return std::nullopt;
+      std::istringstream in(fields.value());
+      checkpoint_worker worker;
+      worker.execs.resize(num_targets);
+      worker.energies.resize(num_targets);
+      in >> worker.next_iteration;
+      for (uint64_t &execs : worker.execs)
+      {
+        in >> execs;
+      }
+      for (double &energy : worker.energies)
+      {
+        in >> energy;
+      }
+      if (in.fail())
+        return std::nullopt;
+      state.workers.push_back(std::move(worker));
+    }
+  }
+  catch (const std::exception &)
+  {
+    return std::nullopt;
+  }
+  return state;
+}
+
+void save_checkpoint()
+{
+  // the stats thread and the end of the campaign may both save
+  static std::mutex save_mutex;
+  static size_t saved_corpus_size = std::numeric_limits<size_t>::max();
+  std::lock_guard<std::mutex> save_lock(save_mutex);
+
+  const std::filesystem::path &dir = get_checkpoint_dir().value();
+  const auto &fuzzs                = get_fuzzs();
+  std::error_code ec;
+  std::filesystem::create_directories(dir, ec);
+
+  // the state is written last, so it never refers to a newer corpus
+  if (get_corpus_size() != saved_corpus_size)
+  {
+    std::vector<std::vector<std::vector<uint8_t>>> inputs(fuzzs.size());
+    {
+      std::lock_guard<std::mutex> lock(get_corpus_mutex());
+      for (const auto &entry : get_corpus())
+      {
+        inputs[entry.target].push_back(entry.data);
+      }
+      saved_corpus_size = get_corpus().size();
+    }
+    for (size_t target = 0; target < fuzzs.size(); target++)
+    {
+      std::filesystem::path target_dir = target_corpus_dir(
+        dir / CHECKPOINT_CORPUS_NAME, fuzzs[target].first);
+      std::filesystem::create_directories(target_dir, ec);
+      write_pack(target_dir, inputs[target]);
+    }
+  }
+
+  std::vector<uint64_t> coverage = coverage_save();
+  write_file_atomically(dir / CHECKPOINT_COVERAGE_NAME,
+                        reinterpret_cast<const uint8_t *>(coverage.data()),
+                        coverage.size() * sizeof(uint64_t));
+
+  checkpoint state;
+  state.seed       = get_seed();
+  state.iterations = get_iterations();
+  for (const auto &fuzz : fuzzs)
+  {
+    state.targets.push_back(fuzz.first);
+  }
+  const fuzz_stats &stats = get_fuzz_stats();
+  for (const auto &worker : get_fuzz_workers())
+  {
+    checkpoint_worker saved;
+    {
+      std::lock_guard<std::mutex> lock(worker->checkpoint_mutex);
+      saved.next_iteration = worker->checkpoint_iteration;
+      saved.energies.assign(fuzzs.size(), SCHEDULER_MAX_ENERGY);
+      for (size_t i = 0; i < worker->targets.size(); i++)
+      {
+        saved.energies[worker->targets[i]] = worker->energies[i];
+      }
+    }
+    saved.execs.resize(fuzzs.size(), 0);
+    for (size_t t = 0; t < fuzzs.size() && t < stats.get_num_targets(); t++)
+    {
+      if (worker->id < stats.get_num_workers())
+        saved.execs[t] = stats.get(worker->id, t);
+    }
+    state.workers.push_back(std::move(saved));
+  }
+
+  bool written = write_checkpoint_state(dir / CHECKPOINT_STATE_NAME, state);
+  std::lock_guard<std::mutex> lock(get_stream_mutex());
+  if (written)
+    std::cout << "Saved checkpoint " << dir.string() << " ("
+              << state.iterations << " iterations)" << std::endl;
+  else
+    std::cerr << "Could not write checkpoint " << dir << "\n";
+}
+
+void checkpoint_poll()
+{
+  static std::mutex poll_mutex;
+  static std::chrono::steady_clock::time_point last =
+    std::chrono::steady_clock::now();
+  if (!get_checkpoint_dir().has_value())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(poll_mutex);
+    auto now = std::chrono::steady_clock::now();
+    if (now - last < std::chrono::seconds(get_checkpoint_interval().load()))
+      return;
+    last = now;
+  }
+  save_checkpoint();
+}
+
+static std::optional<checkpoint> &get_resumed_checkpoint()
+{
+  static std::optional<checkpoint> resumed = std::nullopt;
+  return resumed;
+}
+
+void load_checkpoint()
+{
+  if (!get_resume_dir().has_value())
+    return;
+  const std::filesystem::path &dir = get_resume_dir().value();
+  auto state = read_checkpoint_state(dir / CHECKPOINT_STATE_NAME);
+  if (!state.has_value())
+  {
+    std::lock_guard<std::mutex> lock(get_stream_mutex());
+    std::cerr << "Could not read checkpoint " << dir << "\n";
+    std::exit(1);
+  }
+
+  set_seed(state->seed);
+  get_iterations() = state->iterations;
+
+  const auto &fuzzs = get_fuzzs();
+  size_t num_loaded = 0;
+  for (size_t target = 0; target < fuzzs.size(); target++)
+  {
+    auto inputs = load_inputs(
+      target_corpus_dir(dir / CHECKPOINT_CORPUS_NAME, fuzzs[target].first));
+    std::lock_guard<std::mutex> lock(get_corpus_mutex());
+    for (auto &input : inputs)
+    {
+      get_corpus().push_back({target, std::move(input)});
+      num_loaded++;
+    }
+  }
+
+  std::ifstream file(dir / CHECKPOINT_COVERAGE_NAME, std::ios::binary);
+  std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)),
+                             std::istreambuf_iterator<char>());
+  std::vector<uint64_t> coverage(bytes.size() / sizeof(uint64_t));
+  std::memcpy(coverage.data(), bytes.data(),
+              coverage.size() * sizeof(uint64_t));
+  const bool coverage_restored = coverage_load(coverage);
+
+  get_resumed_checkpoint() = std::move(state);
+  std::lock_guard<std::mutex> lock(get_stream_mutex());
+  std::cout << "Resuming " << dir.string() << ": seed "
+            << get_resumed_checkpoint()->seed << ", "
+            << get_resumed_checkpoint()->iterations << " iterations, "
+            << num_loaded << " inputs, coverage "
+            << (coverage_restored ? "restored" : "rebuilt from the inputs")
+            << "\n";
+}
+
+void restore_checkpoint_workers()
+{
+  const auto &resumed = get_resumed_checkpoint();
+  if (!resumed.has_value())
+    return;
+
+  const auto &fuzzs = get_fuzzs();
+  std::unordered_map<std::string, size_t> saved_targets;
+  for (size_t t = 0; t < resumed->targets.size(); t++)
+  {
+    saved_targets[resumed->targets[t]] = t;
+  }
+  auto &workers = get_fuzz_workers();
+  for (size_t w = 0; w < workers.size() && w < resumed->workers.size(); w++)
+  {
+    fuzz_worker &worker            = *workers[w];
+    const checkpoint_worker &saved = resumed->workers[w];
+    std::lock_guard<std::mutex> lock(worker.checkpoint_mutex);
+    worker.next_iteration       = saved.next_iteration;
+    worker.checkpoint_iteration = saved.next_iteration;
+    for (size_t i = 0; i < worker.targets.size(); i++)
+    {
+      auto it = saved_targets.find(fuzzs[worker.targets[i]].first);
+      if (it == saved_targets.end())
+        continue;
+      worker.energies[i] = saved.energies[it->second];
+      worker.iterations += saved.execs[it->second];
+      get_fuzz_stats().add(worker.id, worker.targets[i],
+                           saved.execs[it->second]);
+    }
+  }
+}
+
+static void on_stop_signal(int signal)
+{
+  request_fuzz_stop();
+  // a second signal kills the process
+  std::signal(signal, SIG_DFL);
+}
+
+void install_checkpoint_signals()
+{
+  if (!get_checkpoint_dir().has_value())
+    return;
+  std::signal(SIGINT, on_stop_signal);
+  std::signal(SIGTERM, on_stop_signal);
+}
+
+} // namespace valfuzz
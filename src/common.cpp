@@ -3,7 +3,11 @@
 // Mail:    giovanni.santini@proton.me
 // Github:  @San7o
 
+#include <algorithm>
+#include <ctime>
+#include <iterator>
 #include <valfuzz/common.hpp>
+#include <valfuzz/topology.hpp>
 
 namespace valfuzz
 {
@@ -29,11 +33,9 @@ std::atomic<bool> &get_verbose()
 
 std::atomic<long unsigned int> &get_max_num_threads()
 {
-#if __cplusplus >= 202002L // C++20
-  constinit
-#endif
-    static std::atomic<long unsigned int>
-      max_num_threads = 4;
+  // one thread for each cpu this process may run on
+  static std::atomic<long unsigned int> max_num_threads =
+    get_cpu_topology().logical_cpus;
   return max_num_threads;
 }
 
@@ -56,10 +58,197 @@ std::atomic<bool> &get_is_threaded()
   return is_threaded;
 }
 
-std::vector<std::thread> &get_thread_pool()
+/* The pool and index of the worker running on this thread */
+thread_local const thread_pool *current_pool = nullptr;
+thread_local size_t current_worker           = 0;
+
+thread_pool::~thread_pool()
+{
+  stop();
+}
+
+void thread_pool::start(size_t num_threads)
+{
+  stop();
+  num_threads = std::max<size_t>(num_threads, 1);
+  queues      = std::make_unique<task_queue[]>(num_threads);
+  num_queues  = num_threads;
+  stopping    = false;
+  for (size_t i = 0; i < num_threads; i++)
+  {
+    threads.push_back(std::thread([this, i]() { work(i); }));
+  }
+}
+
+void thread_pool::stop()
+{
+  if (threads.empty())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    stopping = true;
+  }
+  work_cv.notify_all();
+  for (auto &thread : threads)
+  {
+    thread.join();
+  }
+  threads.clear();
+}
+
+void thread_pool::submit(task t)
+{
+  push(std::move(t), nullptr);
+}
+
+void thread_pool::push(task t, task_group *group)
+{
+  if (num_queues == 0)
+    start(1);
+  const size_t index = current_pool == this
+                         ? current_worker
+                         : next_queue.fetch_add(1) % num_queues;
+  pending.fetch_add(1);
+  if (group != nullptr)
+    group->queued.fetch_add(1);
+  {
+    std::lock_guard<std::mutex> lock(queues[index].mutex);
+    queues[index].tasks.push_back({std::move(t), group});
+  }
+  queued.fetch_add(1);
+  // taking the lock orders the push with a worker going to sleep
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+  }
+  work_cv.notify_one();
+}
+
+bool thread_pool::run_one(size_t first, task_group *group)
+{
+  if ((group != nullptr ? group->queued.load() : queued.load()) == 0)
+    return false;
+  queued_task t;
+  for (size_t k = 0; k < num_queues && !t.run; k++)
+  {
+    task_queue &queue = queues[(first + k) % num_queues];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    auto &tasks = queue.tasks;
+    if (tasks.empty())
+      continue;
+    // thieves take the tasks submitted last
+    if (group == nullptr)
+    {
+      auto it = k == 0 ? tasks.begin() : std::prev(tasks.end());
+      t       = std::move(*it);
+      tasks.erase(it);
+      continue;
+    }
+    auto it = std::find_if(tasks.begin(), tasks.end(),
+                           [group](const queued_task &queued)
+                           { return queued.group == group; });
+    if (it == tasks.end())
+      continue;
+    t = std::move(*it);
+    tasks.erase(it);
+  }
+  if (!t.run)
+    return false;
+  queued.fetch_sub(1);
+  if (t.group != nullptr)
+    t.group->queued.fetch_sub(1);
+  t.run();
+  if (t.group != nullptr)
+    t.group->remaining.fetch_sub(1);
+  if (pending.fetch_sub(1) == 1 || waiters.load() > 0)
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    done_cv.notify_all();
+  }
+  return true;
+}
+
+void thread_pool::help_until(const std::atomic<size_t> &remaining,
+                             task_group *group)
+{
+  const size_t first = current_pool == this ? current_worker : 0;
+  const std::atomic<size_t> &runnable =
+    group != nullptr ? group->queued : queued;
+  while (remaining.load() > 0)
+  {
+    if (run_one(first, group))
+      continue;
+    waiters.fetch_add(1);
+    {
+      std::unique_lock<std::mutex> lock(sleep_mutex);
+      done_cv.wait(lock, [&]()
+                   { return remaining.load() == 0 || runnable.load() > 0; });
+    }
+    waiters.fetch_sub(1);
+  }
+}
+
+void thread_pool::wait()
+{
+  help_until(pending, nullptr);
+}
+
+void thread_pool::parallel_for(
+  size_t count, const std::function<void(size_t, size_t)> &body)
+{
+  const size_t num_chunks = std::min(count, size() + 1);
+  if (num_chunks <= 1)
+  {
+    body(0, count);
+    return;
+  }
+  task_group group;
+  group.remaining = num_chunks - 1;
+  for (size_t c = 1; c < num_chunks; c++)
+  {
+    push([&, c]()
+         { body(c * count / num_chunks, (c + 1) * count / num_chunks); },
+         &group);
+  }
+  body(0, count / num_chunks);
+  // only the chunks of this call, other tasks may be long or use the
+  // thread local state of the caller
+  help_until(group.remaining, &group);
+}
+
+void thread_pool::work(size_t index)
+{
+  current_pool   = this;
+  current_worker = index;
+  while (true)
+  {
+    if (run_one(index, nullptr))
+      continue;
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+    work_cv.wait(lock, [&]() { return stopping || queued.load() > 0; });
+    if (stopping && queued.load() == 0)
+      return;
+  }
+}
+
+thread_pool &get_thread_pool()
+{
+  static thread_pool pool;
+  if (pool.size() != std::max<size_t>(get_max_num_threads(), 1))
+    pool.start(get_max_num_threads());
+  return pool;
+}
+
+std::atomic<long unsigned int> &get_seed()
+{
+  static std::atomic<long unsigned int> seed =
+    (long unsigned int) std::time(nullptr);
+  return seed;
+}
+
+void set_seed(long unsigned int new_seed)
 {
-  static std::vector<std::thread> thread_pool;
-  return thread_pool;
+  auto &seed = get_seed();
+  seed       = new_seed;
 }
 
 } // namespace valfuzz
@@ -0,0 +1,363 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <unordered_set>
+#include <valfuzz/corpus.hpp>
+#include <valfuzz/data_provider.hpp>
+#include <valfuzz/fuzz.hpp>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace valfuzz
+{
+
+std::optional<std::filesystem::path> &get_corpus_dir()
+{
+  static std::optional<std::filesystem::path> corpus_dir = std::nullopt;
+  return corpus_dir;
+}
+
+std::vector<std::filesystem::path> &get_seed_paths()
+{
+  static std::vector<std::filesystem::path> seed_paths;
+  return seed_paths;
+}
+
+void set_corpus_dir(const std::filesystem::path &dir)
+{
+  auto &corpus_dir = get_corpus_dir();
+  corpus_dir       = dir;
+}
+
+void add_seed_path(const std::filesystem::path &path)
+{
+  get_seed_paths().push_back(path);
+}
+
+uint64_t hash_input(const uint8_t *data, size_t size)
+{
+  uint64_t hash = 0xcbf29ce484222325;
+  for (size_t i = 0; i < size; i++)
+  {
+    hash ^= data[i];
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
+std::string input_file_name(const uint8_t *data, size_t size)
+{
+  static const char digits[] = "0123456789abcdef";
+  uint64_t hash              = hash_input(data, size);
+  std::string name(16, '0');
+  for (int i = 15; i >= 0; i--)
+  {
+    name[(size_t) i] = digits[hash & 0xf];
+    hash >>= 4;
+  }
+  return name;
+}
+
+std::filesystem::path target_corpus_dir(const std::filesystem::path &dir,
+                                        const std::string &target_name)
+{
+  std::string name = target_name;
+  for (char &c : name)
+  {
+    if (!std::isalnum((unsigned char) c) && c != '-' && c != '_')
+      c = '_';
+  }
+  return dir / name;
+}
+
+bool write_file_atomically(const std::filesystem::path &path,
+                           const uint8_t *data, size_t size)
+{
+  // unique per process and thread, shards and isolated workers may
+  // write the same file at once
+  std::filesystem::path tmp = path;
+#if defined(__linux__)
+  tmp += ".tmp" + std::to_string(getpid());
+#else
+  tmp += ".tmp";
+#endif
+  tmp += "-" + std::to_string(
+                 std::hash<std::thread::id>{}(std::this_thread::get_id()));
+  {
+    std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+      return false;
+    file.write(reinterpret_cast<const char *>(data), (std::streamsize) size);
+    if (!file.good())
+      return false;
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp, path, ec);
+  return !ec;
+}
+
+void save_input(const std::filesystem::path &dir, const uint8_t *data,
+                size_t size)
+{
+  std::error_code ec;
+  std::filesystem::create_directories(dir, ec);
+  std::filesystem::path path = dir / input_file_name(data, size);
+  if (std::filesystem::exists(path, ec))
+    return;
+  if (!write_file_atomically(path, data, size))
+  {
+    std::lock_guard<std::mutex> lock(get_stream_mutex());
+    std::cerr << "Could not save input " << path << "\n";
+  }
+}
+
+/* Parse a pack, returns false if it is malformed */
+static bool parse_pack(const uint8_t *pack, size_t size,
+                       std::vector<std::vector<uint8_t>> &inputs,
+                       std::unordered_set<uint64_t> &hashes)
+{
+  const size_t header = sizeof(CORPUS_PACK_MAGIC) - 1 + sizeof(uint64_t);
+  if (size < header ||
+      std::memcmp(pack, CORPUS_PACK_MAGIC, sizeof(CORPUS_PACK_MAGIC) - 1) != 0)
+    return false;
+  uint64_t count;
+  std::memcpy(&count, pack + sizeof(CORPUS_PACK_MAGIC) - 1, sizeof(count));
+  if (count > (size - header) / (3 * sizeof(uint64_t)))
+    return false;
+
+  const uint8_t *index = pack + header;
+  for (uint64_t i = 0; i < count; i++)
+  {
+    uint64_t entry[3];  // hash, offset, size
+    std::memcpy(entry, index + i * sizeof(entry), sizeof(entry));
+    if (entry[1] > size || entry[2] > size - entry[1])
+      return false;
+    if (hashes.insert(entry[0]).second)
+      inputs.emplace_back(pack + entry[1], pack + entry[1] + entry[2]);
+  }
+  return true;
+}
+
+static void read_pack(const std::filesystem::path &path,
+                      std::vector<std::vector<uint8_t>> &inputs,
+                      std::unordered_set<uint64_t> &hashes)
+{
+  bool ok = true;
+#if defined(__linux__)
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0)
+  {
+    close(fd);
+    return;
+  }
+  size_t size = (size_t) st.st_size;
+  void *pack  = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (pack == MAP_FAILED)
+    return;
+  ok = parse_pack(static_cast<const uint8_t *>(pack), size, inputs, hashes);
+  munmap(pack, size);
+#else
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+    return;
+  std::vector<uint8_t> pack((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+  ok = parse_pack(pack.data(), pack.size(), inputs, hashes);
+#endif
+  if (!ok)
+  {
+    std::lock_guard<std::mutex> lock(get_stream_mutex());
+    std::cerr << "Ignoring malformed corpus pack " << path << "\n";
+  }
+}
+
+static std::optional<uint64_t> hash_from_file_name(const std::string &name)
+{
+  if (name.size() != 16)
+    return std::nullopt;
+  uint64_t hash = 0;
+  for (char c : name)
+  {
+    int digit;
+    if (c >= '0' && c <= '9')
+      digit = c - '0';
+    else if (c >= 'a' && c <= 'f')
+      digit = c - 'a' + 10;
+    else
+      return std::nullopt;
+    hash = (hash << 4) | (uint64_t) digit;
+  }
+  return hash;
+}
+
+std::vector<std::vector<uint8_t>>
+load_inputs(const std::filesystem::path &dir)
+{
+  std::vector<std::vector<uint8_t>> inputs;
+  std::unordered_set<uint64_t> hashes;
+  std::error_code ec;
+  if (!std::filesystem::is_directory(dir, ec))
+    return inputs;
+
+  read_pack(dir / CORPUS_PACK_NAME, inputs, hashes);
+
+  size_t unpacked = 0;
+  for (const auto &file : std::filesystem::directory_iterator(dir, ec))
+  {
+    if (!file.is_regular_file(ec))
+      continue;
+    std::string name = file.path().filename().string();
+    if (name == CORPUS_PACK_NAME || name.find(".tmp") != std::string::npos)
+      continue;
+    // named after their hash, no need to open them if packed
+    auto hash = hash_from_file_name(name);
+    if (hash.has_value() && hashes.count(hash.value()) > 0)
+      continue;
+
+    std::ifstream in(file.path(), std::ios::binary);
+    if (!in.is_open())
+      continue;
+    std::vector<uint8_t> input((std::istreambuf_iterator<char>(in)),
+                               std::istreambuf_iterator<char>());
+    if (hashes.insert(hash_input(input.data(), input.size())).second)
+    {
+      inputs.push_back(std::move(input));
+      unpacked++;
+    }
+  }
+
+  if (unpacked > 0)
+    write_pack(dir, inputs);
+  return inputs;
+}
+
+void write_pack(const std::filesystem::path &dir,
+                const std::vector<std::vector<uint8_t>> &inputs)
+{
+  const size_t magic = sizeof(CORPUS_PACK_MAGIC) - 1;
+  uint64_t count     = inputs.size();
+  uint64_t offset    = magic + sizeof(count) + count * 3 * sizeof(uint64_t);
+  std::vector<uint8_t> pack(offset);
+  std::memcpy(pack.data(), CORPUS_PACK_MAGIC, magic);
+  std::memcpy(pack.data() + magic, &count, sizeof(count));
+  for (size_t i = 0; i < inputs.size(); i++)
+  {
+    uint64_t entry[3] = {hash_input(inputs[i].data(), inputs[i].size()),
+                         offset, inputs[i].size()};
+    std::memcpy(pack.data() + magic + sizeof(count) + i * sizeof(entry),
+                entry, sizeof(entry));
+    pack.insert(pack.end(), inputs[i].begin(), inputs[i].end());
+    offset += inputs[i].size();
+  }
+  if (!write_file_atomically(dir / CORPUS_PACK_NAME, pack.data(),
+                             pack.size()))
+  {
+    std::lock_guard<std::mutex> lock(get_stream_mutex());
+    std::cerr << "Could not write corpus pack in " << dir << "\n";
+  }
+}
+
+void load_corpus()
+{
+  if (!get_corpus_dir().has_value())
+    return;
+  const std::filesystem::path &dir = get_corpus_dir().value();
+  const auto &fuzzs                = get_fuzzs();
+
+  // inputs in the top directory are shared by every target
+  auto shared      = load_inputs(dir);
+  size_t num_loaded = 0;
+  for (size_t target = 0; target < fuzzs.size(); target++)
+  {
+    auto inputs = load_inputs(target_corpus_dir(dir, fuzzs[target].first));
+    inputs.insert(inputs.end(), shared.begin(), shared.end());
+    std::lock_guard<std::mutex> lock(get_corpus_mutex());
+    for (auto &input : inputs)
+    {
+      if (input.size() > MAX_FUZZ_INPUT_SIZE)
+        input.resize(MAX_FUZZ_INPUT_SIZE);
+      get_corpus().push_back({target, std::move(input)});
+      num_loaded++;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(get_stream_mutex());
+  std::cout << "Loaded " << num_loaded << " inputs from " << dir << "\n";
+}
+
+static void load_seed_file(const std::filesystem::path &path,
+                           std::vector<std::vector<uint8_t>> &seeds,
+                           std::unordered_set<uint64_t> &hashes)
+{
+  std::ifstream in(path, std::ios::binary);
+  if (!in.is_open())
+    return;
+  std::vector<uint8_t> seed((std::istreambuf_iterator<char>(in)),
+                            std::istreambuf_iterator<char>());
+  if (seed.size() > MAX_FUZZ_INPUT_SIZE)
+    seed.resize(MAX_FUZZ_INPUT_SIZE);
+  if (hashes.insert(hash_input(seed.data(), seed.size())).second)
+    seeds.push_back(std::move(seed));
+}
+
+void load_seeds()
+{
+  std::vector<std::vector<uint8_t>> seeds;
+  std::unordered_set<uint64_t> hashes;
+  for (const auto &path : get_seed_paths())
+  {
+    std::error_code ec;
+    if (std::filesystem::is_regular_file(path, ec))
+    {
+      load_seed_file(path, seeds, hashes);
+      continue;
+    }
+    if (!std::filesystem::is_directory(path, ec))
+    {
+      std::lock_guard<std::mutex> lock(get_stream_mutex());
+      std::cerr << "Seed " << path << " not found\n";
+      std::exit(1);
+    }
+    for (const auto &file :
+         std::filesystem::recursive_directory_iterator(path, ec))
+    {
+      if (file.is_regular_file(ec) &&
+          file.path().filename() != CORPUS_PACK_NAME)
+        load_seed_file(file.path(), seeds, hashes);
+    }
+  }
+  if (get_seed_paths().empty())
+    return;
+
+  const size_t num_fuzzs = get_fuzzs().size();
+  {
+    std::lock_guard<std::mutex> lock(get_corpus_mutex());
+    for (size_t target = 0; target < num_fuzzs; target++)
+    {
+      for (const auto &seed : seeds)
+      {
+        get_corpus().push_back({target, seed});
+      }
+    }
+  }
+  std::lock_guard<std::mutex> lock(get_stream_mutex());
+  std::cout << "Loaded " << seeds.size() << " seeds\n";
+}
+
+} // namespace valfuzz
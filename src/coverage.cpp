@@ -0,0 +1,563 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <array>
+#include <cstring>
+#include <valfuzz/coverage.hpp>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+// The hooks run on every edge of the instrumented code, the thread
+// local variables they touch must not go through __tls_get_addr
+#define VALFUZZ_TLS thread_local __attribute__((tls_model("initial-exec")))
+
+namespace valfuzz
+{
+
+static uint8_t shared_coverage_map[COVERAGE_MAP_SIZE];
+
+VALFUZZ_TLS uint8_t *thread_coverage_map = shared_coverage_map;
+VALFUZZ_TLS uintptr_t thread_previous_location = 0;
+VALFUZZ_TLS uint64_t thread_edge_hits          = 0;
+
+static std::atomic<uint64_t> local_coverage_map[COVERAGE_MAP_SIZE / 8];
+static std::atomic<uint64_t> *global_coverage_map = local_coverage_map;
+static std::atomic<uint32_t> num_coverage_guards = 0;
+
+/* Operands of the comparisons of a thread, by comparison site */
+struct cmp_table
+{
+  uint64_t values[CMP_TABLE_SIZE];
+  uint8_t  sizes[CMP_TABLE_SIZE];
+  bool     changed[CMP_TABLE_SIZE];
+  uint8_t  tokens[CMP_TOKEN_TABLE_SIZE][CMP_MAX_TOKEN_SIZE];
+  uint8_t  token_sizes[CMP_TOKEN_TABLE_SIZE];
+  bool     token_changed[CMP_TOKEN_TABLE_SIZE];
+};
+
+static cmp_table shared_cmp_table;
+VALFUZZ_TLS cmp_table *thread_cmp_table = &shared_cmp_table;
+
+#define VALUE_PROFILE_WORDS (VALUE_PROFILE_MAP_BITS / 64)
+static uint64_t shared_value_profile[VALUE_PROFILE_WORDS];
+VALFUZZ_TLS uint64_t *thread_value_profile = shared_value_profile;
+VALFUZZ_TLS bool thread_value_profile_hit  = false;
+
+static std::atomic<uint64_t> local_value_profile[VALUE_PROFILE_WORDS];
+static std::atomic<uint64_t> *global_value_profile = local_value_profile;
+static std::atomic<bool> use_value_profile          = false;
+
+/* AFL style hit count buckets, one bit per bucket */
+static constexpr std::array<uint8_t, 256> make_count_class()
+{
+  std::array<uint8_t, 256> table = {};
+  for (int count = 1; count < 256; count++)
+  {
+    table[(size_t) count] = count == 1    ? 1
+                            : count == 2  ? 2
+                            : count == 3  ? 4
+                            : count < 8   ? 8
+                            : count < 16  ? 16
+                            : count < 32  ? 32
+                            : count < 128 ? 64
+                                          : 128;
+  }
+  return table;
+}
+static constexpr std::array<uint8_t, 256> count_class = make_count_class();
+
+static std::atomic<long unsigned int> local_coverage_edges = 0;
+static std::atomic<long unsigned int> *coverage_edges = &local_coverage_edges;
+
+std::atomic<long unsigned int> &get_coverage_edges()
+{
+  return *coverage_edges;
+}
+
+std::atomic<bool> &get_use_value_profile()
+{
+  return use_value_profile;
+}
+
+void set_use_value_profile(bool use)
+{
+  use_value_profile = use;
+}
+
+void coverage_share_global_map()
+{
+#if defined(__linux__)
+  if (global_coverage_map != local_coverage_map)
+    return;
+  // the value profile and the edge counter go right after the map
+  const size_t size = sizeof(local_coverage_map) +
+                      sizeof(local_value_profile) + sizeof(uint64_t);
+  void *memory      = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED)
+    return;
+  std::atomic<uint64_t> *map = static_cast<std::atomic<uint64_t> *>(memory);
+  for (size_t i = 0; i < COVERAGE_MAP_SIZE / 8; i++)
+  {
+    map[i].store(local_coverage_map[i].load());
+  }
+  std::atomic<uint64_t> *value_profile = map + COVERAGE_MAP_SIZE / 8;
+  for (size_t i = 0; i < VALUE_PROFILE_WORDS; i++)
+  {
+    value_profile[i].store(local_value_profile[i].load());
+  }
+  auto *edges = reinterpret_cast<std::atomic<long unsigned int> *>(
+    value_profile + VALUE_PROFILE_WORDS);
+  edges->store(local_coverage_edges.load());
+  global_coverage_map  = map;
+  global_value_profile = value_profile;
+  coverage_edges       = edges;
+#endif
+}
+
+/* With guards only the first num_guards entries can be hit, the
+ * result is rounded to a cache line */
+static size_t coverage_map_used()
+{
+  const size_t guards = num_coverage_guards.load(std::memory_order_relaxed);
+  if (guards == 0 || guards >= COVERAGE_MAP_SIZE)
+    return COVERAGE_MAP_SIZE;
+  return (guards + 64) & ~size_t{63};
+}
+
+void coverage_thread_init()
+{
+  thread_local std::unique_ptr<uint8_t[]> map;
+  thread_local std::unique_ptr<cmp_table> table;
+  thread_local std::unique_ptr<uint64_t[]> value_profile;
+  if (!map)
+  {
+    map           = std::make_unique<uint8_t[]>(COVERAGE_MAP_SIZE);
+    table         = std::make_unique<cmp_table>();
+    value_profile = std::make_unique<uint64_t[]>(VALUE_PROFILE_WORDS);
+  }
+  thread_coverage_map      = map.get();
+  thread_previous_location = 0;
+  thread_cmp_table         = table.get();
+  thread_value_profile     = value_profile.get();
+  thread_value_profile_hit = false;
+}
+
+void coverage_reset()
+{
+  std::memset(thread_coverage_map, 0, coverage_map_used());
+  thread_previous_location = 0;
+  if (thread_value_profile_hit)
+  {
+    std::memset(thread_value_profile, 0,
+                VALUE_PROFILE_WORDS * sizeof(uint64_t));
+    thread_value_profile_hit = false;
+  }
+}
+
+uint64_t coverage_edge_hits()
+{
+  return thread_edge_hits;
+}
+
+bool coverage_has_hits()
+{
+  const size_t used = coverage_map_used();
+  for (size_t i = 0; i < used; i++)
+  {
+    if (thread_coverage_map[i] != 0)
+      return true;
+  }
+  return false;
+}
+
+/* Count the bytes of a word that went from never hit to hit */
+static void count_new_edges(uint64_t before, uint64_t added)
+{
+  for (int b = 0; b < 8; b++)
+  {
+    uint64_t mask = (uint64_t) 0xff << (b * 8);
+    if ((before & mask) == 0 && (added & mask) != 0)
+      get_coverage_edges()++;
+  }
+}
+
+/* Merge one 8 byte word of the thread's map, returns true if it
+ * contributed new bits to the global map */
+static bool coverage_update_word(size_t w)
+{
+  uint64_t classified = 0;
+  for (int b = 0; b < 8; b++)
+  {
+    uint8_t count = thread_coverage_map[w * 8 + (size_t) b];
+    classified |= (uint64_t) count_class[count] << (b * 8);
+  }
+  // leave the map clean for the next input
+  std::memset(thread_coverage_map + w * 8, 0, 8);
+
+  uint64_t seen = global_coverage_map[w].load(std::memory_order_relaxed);
+  if ((classified & ~seen) == 0)
+    return false;
+
+  uint64_t before = global_coverage_map[w].fetch_or(classified);
+  uint64_t added  = classified & ~before;
+  if (added == 0)
+    return false;
+
+  count_new_edges(before, added);
+  return true;
+}
+
+/* Merge the thread's value profile into the global one and clear it */
+static bool value_profile_update()
+{
+  bool found_new = false;
+  for (size_t w = 0; w < VALUE_PROFILE_WORDS; w++)
+  {
+    uint64_t bits = thread_value_profile[w];
+    if (bits == 0)
+      continue;
+    thread_value_profile[w] = 0;
+    if ((bits & ~global_value_profile[w].load(std::memory_order_relaxed)) ==
+        0)
+      continue;
+    found_new |= (bits & ~global_value_profile[w].fetch_or(bits)) != 0;
+  }
+  thread_value_profile_hit = false;
+  return found_new;
+}
+
+bool coverage_update()
+{
+  const size_t used        = coverage_map_used();
+  bool found_new           = false;
+  thread_previous_location = 0;
+  if (thread_value_profile_hit)
+    found_new = value_profile_update();
+  // most of the map is zero, skip it one cache line at a time
+  for (size_t line = 0; line < used; line += 64)
+  {
+    uint64_t words[8];
+    std::memcpy(words, thread_coverage_map + line, sizeof(words));
+    uint64_t any = 0;
+    for (int i = 0; i < 8; i++)
+    {
+      any |= words[i];
+    }
+    if (any == 0)
+      continue;
+
+    for (size_t i = 0; i < 8 && line + i * 8 < used; i++)
+    {
+      if (words[i] != 0)
+        found_new |= coverage_update_word(line / 8 + i);
+    }
+  }
+  return found_new;
+}
+
+std::vector<uint64_t> coverage_save()
+{
+  std::vector<uint64_t> words;
+  words.reserve(1 + COVERAGE_MAP_SIZE / 8 + VALUE_PROFILE_WORDS);
+  words.push_back(num_coverage_guards.load());
+  for (size_t i = 0; i < COVERAGE_MAP_SIZE / 8; i++)
+  {
+    words.push_back(global_coverage_map[i].load(std::memory_order_relaxed));
+  }
+  for (size_t i = 0; i < VALUE_PROFILE_WORDS; i++)
+  {
+    words.push_back(global_value_profile[i].load(std::memory_order_relaxed));
+  }
+  return words;
+}
+
+bool coverage_load(const std::vector<uint64_t> &words)
+{
+  // without guards edges are hashed from return addresses, which
+  // change from run to run with ASLR
+  const uint64_t guards = num_coverage_guards.load();
+  if (guards == 0 || words.empty() || words[0] != guards ||
+      words.size() != 1 + COVERAGE_MAP_SIZE / 8 + VALUE_PROFILE_WORDS)
+    return false;
+  for (size_t i = 0; i < COVERAGE_MAP_SIZE / 8; i++)
+  {
+    uint64_t before = global_coverage_map[i].fetch_or(words[1 + i]);
+    count_new_edges(before, words[1 + i] & ~before);
+  }
+  for (size_t i = 0; i < VALUE_PROFILE_WORDS; i++)
+  {
+    global_value_profile[i].fetch_or(words[1 + COVERAGE_MAP_SIZE / 8 + i]);
+  }
+  return true;
+}
+
+void coverage_take_cmp_operands(
+  const std::function<void(const uint8_t *, size_t)> &add)
+{
+  cmp_table &table = *thread_cmp_table;
+  for (size_t i = 0; i < CMP_TABLE_SIZE; i++)
+  {
+    if (!table.changed[i])
+      continue;
+    table.changed[i] = false;
+    // host byte order, like data_provider::consume<T>()
+    uint8_t bytes[sizeof(uint64_t)];
+    std::memcpy(bytes, &table.values[i], sizeof(bytes));
+    add(bytes, table.sizes[i]);
+  }
+  for (size_t i = 0; i < CMP_TOKEN_TABLE_SIZE; i++)
+  {
+    if (!table.token_changed[i])
+      continue;
+    table.token_changed[i] = false;
+    add(table.tokens[i], table.token_sizes[i]);
+  }
+}
+
+/* Hash of the address of a comparison site */
+static inline uintptr_t cmp_site(const void *pc)
+{
+  uintptr_t site = (uintptr_t) pc;
+  return (site >> 4) ^ (site << 8) ^ (site >> 17);
+}
+
+static inline void value_profile(uintptr_t site, uint64_t a, uint64_t b)
+{
+  if (!use_value_profile.load(std::memory_order_relaxed))
+    return;
+  // one feature per site and distance between the operands
+  const size_t bit = (site * 65 + (size_t) __builtin_popcountll(a ^ b)) &
+                     (VALUE_PROFILE_MAP_BITS - 1);
+  thread_value_profile[bit / 64] |= uint64_t{1} << (bit % 64);
+  thread_value_profile_hit = true;
+}
+
+/* Record a constant operand, zero and all ones are not worth a token */
+static inline void record_operand(uintptr_t site, uint64_t value,
+                                  uint8_t size)
+{
+  const uint64_t all_ones = size == 8 ? ~uint64_t{0}
+                                      : (uint64_t{1} << (size * 8)) - 1;
+  if (value == 0 || value == all_ones)
+    return;
+  cmp_table &table = *thread_cmp_table;
+  const size_t i   = site % CMP_TABLE_SIZE;
+  if (table.values[i] == value && table.sizes[i] == size)
+    return;
+  table.values[i]  = value;
+  table.sizes[i]   = size;
+  table.changed[i] = true;
+}
+
+static inline void trace_cmp(const void *pc, uint64_t a, uint64_t b)
+{
+  value_profile(cmp_site(pc), a, b);
+}
+
+static inline void trace_const_cmp(const void *pc, uint64_t constant,
+                                   uint64_t value, uint8_t size)
+{
+  const uintptr_t site = cmp_site(pc);
+  value_profile(site, constant, value);
+  if (constant != value)
+    record_operand(site, constant, size);
+}
+
+static inline void record_buffer(size_t i, const void *buffer, size_t n)
+{
+  cmp_table &table = *thread_cmp_table;
+  const uint8_t size =
+    (uint8_t) (n < CMP_MAX_TOKEN_SIZE ? n : CMP_MAX_TOKEN_SIZE);
+  if (table.token_sizes[i] == size &&
+      std::memcmp(table.tokens[i], buffer, size) == 0)
+    return;
+  std::memcpy(table.tokens[i], buffer, size);
+  table.token_sizes[i]   = size;
+  table.token_changed[i] = true;
+}
+
+/* Either buffer may be the input, keep both. The constant one does not
+ * change between calls, so it reaches the dictionary only once. Each
+ * side is read only up to its own size */
+static inline void trace_buffers(const void *pc, const void *s1,
+                                 size_t n1, const void *s2, size_t n2)
+{
+  const size_t i = (cmp_site(pc) * 2) % CMP_TOKEN_TABLE_SIZE;
+  if (n1 > 0)
+    record_buffer(i, s1, n1);
+  if (n2 > 0)
+    record_buffer(i + 1, s2, n2);
+}
+
+static inline size_t bounded_strlen(const char *s, size_t n)
+{
+  size_t len = 0;
+  while (len < n && s[len] != '\0')
+  {
+    len++;
+  }
+  return len;
+}
+
+} // namespace valfuzz
+
+extern "C"
+{
+
+  void __sanitizer_cov_trace_pc_guard_init(uint32_t *start, uint32_t *stop)
+  {
+    if (start == stop || *start)
+      return;
+    for (uint32_t *guard = start; guard < stop; guard++)
+    {
+      *guard = ++valfuzz::num_coverage_guards;
+    }
+  }
+
+  void __sanitizer_cov_trace_pc_guard(uint32_t *guard)
+  {
+    valfuzz::thread_coverage_map[*guard & (COVERAGE_MAP_SIZE - 1)]++;
+    valfuzz::thread_edge_hits++;
+  }
+
+  void __sanitizer_cov_trace_pc()
+  {
+    // gcc reports basic blocks, edges are hashed from the previous
+    // and the current location like AFL does
+    uintptr_t location = (uintptr_t) __builtin_return_address(0);
+    location           = (location >> 4) ^ (location << 8);
+    valfuzz::thread_coverage_map[(location ^
+                                  valfuzz::thread_previous_location) &
+                                 (COVERAGE_MAP_SIZE - 1)]++;
+    valfuzz::thread_previous_location = location >> 1;
+    valfuzz::thread_edge_hits++;
+  }
+
+#define VALFUZZ_PC __builtin_return_address(0)
+
+  void __sanitizer_cov_trace_cmp1(uint8_t arg1, uint8_t arg2)
+  {
+    valfuzz::trace_cmp(VALFUZZ_PC, arg1, arg2);
+  }
+
+  void __sanitizer_cov_trace_cmp2(uint16_t arg1, uint16_t arg2)
+  {
+    valfuzz::trace_cmp(VALFUZZ_PC, arg1, arg2);
+  }
+
+  void __sanitizer_cov_trace_cmp4(uint32_t arg1, uint32_t arg2)
+  {
+    valfuzz::trace_cmp(VALFUZZ_PC, arg1, arg2);
+  }
+
+  void __sanitizer_cov_trace_cmp8(uint64_t arg1, uint64_t arg2)
+  {
+    valfuzz::trace_cmp(VALFUZZ_PC, arg1, arg2);
+  }
+
+  // arg1 is the compile time constant
+  void __sanitizer_cov_trace_const_cmp1(uint8_t arg1, uint8_t arg2)
+  {
+    valfuzz::trace_const_cmp(VALFUZZ_PC, arg1, arg2, 1);
+  }
+
+  void __sanitizer_cov_trace_const_cmp2(uint16_t arg1, uint16_t arg2)
+  {
+    valfuzz::trace_const_cmp(VALFUZZ_PC, arg1, arg2, 2);
+  }
+
+  void __sanitizer_cov_trace_const_cmp4(uint32_t arg1, uint32_t arg2)
+  {
+    valfuzz::trace_const_cmp(VALFUZZ_PC, arg1, arg2, 4);
+  }
+
+  void __sanitizer_cov_trace_const_cmp8(uint64_t arg1, uint64_t arg2)
+  {
+    valfuzz::trace_const_cmp(VALFUZZ_PC, arg1, arg2, 8);
+  }
+
+  void __sanitizer_cov_trace_cmpf(float arg1, float arg2)
+  {
+    uint32_t a, b;
+    std::memcpy(&a, &arg1, sizeof(a));
+    std::memcpy(&b, &arg2, sizeof(b));
+    valfuzz::trace_cmp(VALFUZZ_PC, a, b);
+  }
+
+  void __sanitizer_cov_trace_cmpd(double arg1, double arg2)
+  {
+    uint64_t a, b;
+    std::memcpy(&a, &arg1, sizeof(a));
+    std::memcpy(&b, &arg2, sizeof(b));
+    valfuzz::trace_cmp(VALFUZZ_PC, a, b);
+  }
+
+  // cases[0] is the number of cases, cases[1] their size in bits
+  void __sanitizer_cov_trace_switch(uint64_t val, uint64_t *cases)
+  {
+    const uintptr_t site = valfuzz::cmp_site(VALFUZZ_PC);
+    const uint8_t size   = (uint8_t) (cases[1] / 8);
+    for (uint64_t i = 0; i < cases[0]; i++)
+    {
+      // a different site for every case
+      valfuzz::value_profile(site + i, cases[2 + i], val);
+      if (cases[2 + i] != val)
+        valfuzz::record_operand(site + i, cases[2 + i], size);
+    }
+  }
+
+  void __sanitizer_weak_hook_memcmp(void *caller_pc, const void *s1,
+                                    const void *s2, size_t n, int result)
+  {
+    if (result != 0)
+      valfuzz::trace_buffers(caller_pc, s1, n, s2, n);
+  }
+
+  void __sanitizer_weak_hook_strncmp(void *caller_pc, const char *s1,
+                                     const char *s2, size_t n, int result)
+  {
+    if (result == 0)
+      return;
+    const size_t len1 = valfuzz::bounded_strlen(s1, n);
+    const size_t len2 = valfuzz::bounded_strlen(s2, n);
+    // the strings may end before n, do not read past the shorter one
+    valfuzz::trace_buffers(caller_pc, s1, len1, s2, len2);
+  }
+
+  void __sanitizer_weak_hook_strcmp(void *caller_pc, const char *s1,
+                                    const char *s2, int result)
+  {
+    __sanitizer_weak_hook_strncmp(caller_pc, s1, s2, CMP_MAX_TOKEN_SIZE,
+                                  result);
+  }
+
+  void __sanitizer_weak_hook_strncasecmp(void *caller_pc, const char *s1,
+                                         const char *s2, size_t n,
+                                         int result)
+  {
+    __sanitizer_weak_hook_strncmp(caller_pc, s1, s2, n, result);
+  }
+
+  void __sanitizer_weak_hook_strcasecmp(void *caller_pc, const char *s1,
+                                        const char *s2, int result)
+  {
+    __sanitizer_weak_hook_strncmp(caller_pc, s1, s2, CMP_MAX_TOKEN_SIZE,
+                                  result);
+  }
+
+  void __sanitizer_weak_hook_strstr(void *caller_pc, const char *s1,
+                                    const char *s2, char *result)
+  {
+    // s1 is the haystack, usually the input
+    if (result == nullptr)
+      valfuzz::record_buffer(
+        (valfuzz::cmp_site(caller_pc) * 2) % CMP_TOKEN_TABLE_SIZE, s2,
+        valfuzz::bounded_strlen(s2, CMP_MAX_TOKEN_SIZE));
+    (void) s1;
+  }
+}
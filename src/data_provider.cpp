@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <valfuzz/data_provider.hpp>
+
+namespace valfuzz
+{
+
+void data_provider::start_generating()
+{
+  generator.emplace(generator_seed);
+  // log-uniform length, short inputs are cheaper to run and mutate
+  size_t limit = (size_t) 1 << ((*generator)() % 16);
+  if (limit > capacity)
+    limit = capacity;
+  input_end = static_cast<size_t>((*generator)() % (limit + 1));
+  generating = true;
+}
+
+void data_provider::generate(size_t up_to)
+{
+  if (!generating)
+    start_generating();
+  // generate whole words, a few at a time
+  size_t target = (up_to + 63) & ~size_t{63};
+  if (target > input_end)
+    target = input_end;
+  while (input_size < target)
+  {
+    uint64_t word = (*generator)();
+    size_t len    = target - input_size < sizeof(word) ? target - input_size
+                                                       : sizeof(word);
+    std::memcpy(buffer + input_size, &word, len);
+    input_size += len;
+  }
+}
+
+void data_provider::materialize()
+{
+  if (buffer == nullptr)
+    return;
+  if (!generating)
+    start_generating();
+  generate(input_end);
+}
+
+} // namespace valfuzz
@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <valfuzz/diff.hpp>
+
+namespace valfuzz
+{
+
+std::atomic<double> &get_diff_tolerance()
+{
+  static std::atomic<double> diff_tolerance = DIFF_DEFAULT_TOLERANCE;
+  return diff_tolerance;
+}
+
+void set_diff_tolerance(double tolerance)
+{
+  auto &diff_tolerance = get_diff_tolerance();
+  diff_tolerance       = tolerance;
+}
+
+void report_diff_mismatch(const std::string &test_name, size_t mismatches,
+                          size_t batch_size, size_t index,
+                          const std::string &input,
+                          const std::string &expected,
+                          const std::string &actual)
+{
+  log_line(std::cerr) << "test: " << test_name << ", Outputs differ on "
+                      << mismatches << " of " << batch_size
+                      << " inputs, smallest at " << index << "\n"
+                      << "  input: " << input << "\n"
+                      << "  reference: " << expected << "\n"
+                      << "  optimized: " << actual << "\n";
+}
+
+} // namespace valfuzz
@@ -0,0 +1,296 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <cstdio>
+#include <cstring>
+#include <valfuzz/failures.hpp>
+#include <valfuzz/test.hpp>
+
+#if defined(__GLIBC__)
+#include <execinfo.h>
+#include <link.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace valfuzz
+{
+
+static failure_table local_table;
+static failure_table *table_in_use = &local_table;
+
+failure_table &get_failure_table()
+{
+  return *table_in_use;
+}
+
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t size)
+{
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; i++)
+  {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
+/* FNV-1a of the name, then of the site, never zero */
+static uint64_t site_signature(const std::string &name, const char *site,
+                               int64_t value) noexcept
+{
+  uint64_t hash = hash_bytes(0xcbf29ce484222325, name.data(), name.size());
+  hash          = hash_bytes(hash, site, std::strlen(site) + 1);
+  hash          = hash_bytes(hash, &value, sizeof(value));
+  return hash == 0 ? 1 : hash;
+}
+
+uint64_t failure_signature(const std::string &name, const char *file,
+                           int line) noexcept
+{
+  return site_signature(name, file, line);
+}
+
+uint64_t crash_signature(const std::string &name, int signal,
+                         uint64_t backtrace) noexcept
+{
+  uint64_t hash = site_signature(name, "signal", signal);
+  hash          = hash_bytes(hash, &backtrace, sizeof(backtrace));
+  return hash == 0 ? 1 : hash;
+}
+
+/* The bucket of signature, inserted if it is new. Returns nullptr if
+ * the table is full */
+static failure_bucket *find_bucket(failure_table &table, uint64_t signature,
+                                   bool insert, bool &inserted) noexcept
+{
+  inserted = false;
+  for (size_t probe = 0; probe < FAILURE_BUCKETS; probe++)
+  {
+    failure_bucket &bucket =
+      table.buckets[(signature + probe) % FAILURE_BUCKETS];
+    uint64_t current = bucket.signature.load(std::memory_order_acquire);
+    if (current == 0 && insert)
+    {
+      if (bucket.signature.compare_exchange_strong(current, signature))
+      {
+        inserted = true;
+        return &bucket;
+      }
+      // someone else took it, current is theirs
+    }
+    if (current == signature)
+      return &bucket;
+    if (current == 0)
+      return nullptr;
+  }
+  return nullptr;
+}
+
+template <typename Site>
+static bool count(failure_table &table, uint64_t signature,
+                  const Site &write_site) noexcept
+{
+  bool inserted;
+  failure_bucket *bucket = find_bucket(table, signature, true, inserted);
+  if (bucket == nullptr)
+    return true;
+  bucket->count.fetch_add(1, std::memory_order_relaxed);
+  if (inserted)
+  {
+    write_site(bucket->site);
+    bucket->ready.store(true, std::memory_order_release);
+  }
+  return inserted;
+}
+
+bool count_failure(uint64_t signature, const std::string &name,
+                   const char *file, int line, failure_table &table) noexcept
+{
+  return count(table, signature,
+               [&](char *site)
+               {
+                 std::snprintf(site, FAILURE_SITE_SIZE, "test: %s, %s:%d",
+                               name.c_str(), file, line);
+               });
+}
+
+bool count_crash(uint64_t signature, const std::string &name, int signal,
+                 failure_table &table) noexcept
+{
+  return count(table, signature,
+               [&](char *site)
+               {
+                 std::snprintf(site, FAILURE_SITE_SIZE,
+                               "test: %s, signal %d", name.c_str(), signal);
+               });
+}
+
+uint64_t &get_thread_failure_signature()
+{
+  thread_local uint64_t signature = 0;
+  return signature;
+}
+
+bool assertion_failed(const std::string &name, const char *file,
+                      int line) noexcept
+{
+  get_thread_has_failed() = true;
+  // a store on every failure would bounce the line between workers
+  if (!get_has_failed_once().load(std::memory_order_relaxed))
+    get_has_failed_once().store(true);
+
+  const uint64_t signature = failure_signature(name, file, line);
+  uint64_t &thread_signature = get_thread_failure_signature();
+  if (thread_signature == 0)
+    thread_signature = signature;
+  return count_failure(signature, name, file, line);
+}
+
+bool claim_failure(uint64_t signature, failure_table &table) noexcept
+{
+  // failures that were not counted get a bucket too
+  bool inserted;
+  failure_bucket *bucket = find_bucket(table, signature, true, inserted);
+  if (bucket == nullptr)
+    return true;
+  return !bucket->saved.exchange(true);
+}
+
+uint64_t failure_count(uint64_t signature, failure_table &table) noexcept
+{
+  bool inserted;
+  failure_bucket *bucket = find_bucket(table, signature, false, inserted);
+  if (bucket == nullptr)
+    return 0;
+  return bucket->count.load(std::memory_order_relaxed);
+}
+
+#if defined(__GLIBC__)
+/* The executable text of libvalfuzz, set by backtrace_init(). Empty
+ * if valfuzz is linked into the executable, its frames are not
+ * skipped then */
+static uintptr_t valfuzz_text_begin = 0;
+static uintptr_t valfuzz_text_end   = 0;
+static std::atomic<bool> backtrace_ready = false;
+
+struct text_search
+{
+  uintptr_t address;
+  bool      first = true;  // the executable is always the first object
+  bool      found = false;
+  uintptr_t begin = 0;
+  uintptr_t end   = 0;
+};
+
+static int find_text(dl_phdr_info *info, size_t, void *data)
+{
+  text_search &search = *static_cast<text_search *>(data);
+  const bool executable = search.first;
+  search.first          = false;
+  for (size_t i = 0; i < info->dlpi_phnum; i++)
+  {
+    const ElfW(Phdr) &header = info->dlpi_phdr[i];
+    if (header.p_type != PT_LOAD || (header.p_flags & PF_X) == 0)
+      continue;
+    const uintptr_t begin = info->dlpi_addr + header.p_vaddr;
+    const uintptr_t end   = begin + header.p_memsz;
+    if (search.address < begin || search.address >= end)
+      continue;
+    search.found = true;
+    if (!executable)
+    {
+      search.begin = begin;
+      search.end   = end;
+    }
+    return 1;
+  }
+  return 0;
+}
+#endif
+
+void backtrace_init() noexcept
+{
+#if defined(__GLIBC__)
+  if (backtrace_ready.load())
+    return;
+  text_search search;
+  search.address = reinterpret_cast<uintptr_t>(&backtrace_signature);
+  dl_iterate_phdr(find_text, &search);
+  valfuzz_text_begin = search.begin;
+  valfuzz_text_end   = search.end;
+  // backtrace() loads libgcc on its first call
+  void *frame;
+  backtrace(&frame, 1);
+  backtrace_ready.store(true);
+#endif
+}
+
+uint64_t backtrace_signature() noexcept
+{
+#if defined(__GLIBC__)
+  if (!backtrace_ready.load())
+    return 0;
+  // the frames of the fuzz loop depend on how the target was called,
+  // skip them; only raw addresses are compared, the loader lock may be
+  // held by the code that crashed
+  void *frames[FAILURE_BACKTRACE_FRAMES * 4];
+  int num_frames = backtrace(frames, FAILURE_BACKTRACE_FRAMES * 4);
+  uint64_t hash  = 0xcbf29ce484222325;
+  int hashed     = 0;
+  for (int i = 0; i < num_frames && hashed < FAILURE_BACKTRACE_FRAMES; i++)
+  {
+    const uintptr_t address = reinterpret_cast<uintptr_t>(frames[i]);
+    if (address >= valfuzz_text_begin && address < valfuzz_text_end)
+      continue;
+    hash = hash_bytes(hash, &frames[i], sizeof(void *));
+    hashed++;
+  }
+  return hashed == 0 ? 0 : hash;
+#else
+  return 0;
+#endif
+}
+
+void failures_share()
+{
+#if defined(__linux__)
+  if (table_in_use != &local_table)
+    return;
+  void *memory = mmap(nullptr, sizeof(local_table), PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED)
+    return;
+  // anonymous mappings are zeroed, like a new table
+  failure_bucket *shared = static_cast<failure_table *>(memory)->buckets;
+  failure_bucket *local  = local_table.buckets;
+  for (size_t i = 0; i < FAILURE_BUCKETS; i++)
+  {
+    shared[i].signature.store(local[i].signature.load());
+    shared[i].count.store(local[i].count.load());
+    shared[i].saved.store(local[i].saved.load());
+    shared[i].ready.store(local[i].ready.load());
+    std::memcpy(shared[i].site, local[i].site, FAILURE_SITE_SIZE);
+  }
+  table_in_use = static_cast<failure_table *>(memory);
+#endif
+}
+
+void report_failure_counts(failure_table &table)
+{
+  for (size_t i = 0; i < FAILURE_BUCKETS; i++)
+  {
+    const failure_bucket &bucket = table.buckets[i];
+    const uint64_t failures      = bucket.count.load();
+    if (failures <= 1 || !bucket.ready.load(std::memory_order_acquire))
+      continue;
+    std::lock_guard<std::mutex> lock(get_stream_mutex());
+    std::cerr << bucket.site << ", failed " << failures << " times\n";
+  }
+}
+
+} // namespace valfuzz
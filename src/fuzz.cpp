@@ -3,63 +3,288 @@
 // Mail:    giovanni.santini@proton.me
 // Github:  @San7o
 
+#include <valfuzz/checkpoint.hpp>
+#include <valfuzz/corpus.hpp>
+#include <valfuzz/data_provider.hpp>
 #include <valfuzz/fuzz.hpp>
+#include <valfuzz/generators.hpp>
+#include <valfuzz/isolation.hpp>
+#include <valfuzz/mutator.hpp>
+#include <valfuzz/perf.hpp>
+#include <valfuzz/reproducer.hpp>
+#include <valfuzz/scheduler.hpp>
+#include <valfuzz/stats.hpp>
+#include <valfuzz/test.hpp>
 
 namespace valfuzz
 {
 
-std::mt19937 &get_random_engine()
+void random_engine::seed(uint64_t seed) noexcept
 {
-  static std::mt19937 random_engine;
-  return random_engine;
+  // splitmix64
+  for (int i = 0; i < 4; i++)
+  {
+    uint64_t z = (seed += 0x9e3779b97f4a7c15);
+    z          = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z          = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    s[i]       = z ^ (z >> 31);
+  }
+}
+
+void random_engine::jump() noexcept
+{
+  static const uint64_t JUMP[] = {0x180ec6d33cfd0aba, 0xd5a61266f0c9392c,
+                                  0xa9582618e03fc9aa, 0x39abdc4529b1661c};
+  uint64_t s0 = 0;
+  uint64_t s1 = 0;
+  uint64_t s2 = 0;
+  uint64_t s3 = 0;
+  for (int i = 0; i < 4; i++)
+  {
+    for (int b = 0; b < 64; b++)
+    {
+      if (JUMP[i] & (uint64_t{1} << b))
+      {
+        s0 ^= s[0];
+        s1 ^= s[1];
+        s2 ^= s[2];
+        s3 ^= s[3];
+      }
+      (*this)();
+    }
+  }
+  s[0] = s0;
+  s[1] = s1;
+  s[2] = s2;
+  s[3] = s3;
+}
+
+std::atomic<uint64_t> &get_next_random_stream()
+{
+#if __cplusplus >= 202002L // C++20
+  constinit
+#endif
+    static std::atomic<uint64_t>
+      next_stream = 0;
+  return next_stream;
+}
+
+random_engine make_random_stream(uint64_t stream)
+{
+  random_engine engine(get_seed());
+  for (uint64_t i = 0; i < stream; i++)
+  {
+    engine.jump();
+  }
+  return engine;
+}
+
+random_engine &get_random_engine()
+{
+  // threads that never call seed_random_engine get the next free stream
+  thread_local random_engine engine =
+    make_random_stream(get_next_random_stream()++);
+  return engine;
+}
+
+void seed_random_engine(uint64_t stream)
+{
+  get_random_engine() = make_random_stream(stream);
+}
+
+static inline uint64_t mix64(uint64_t z) noexcept
+{
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+  return z ^ (z >> 31);
+}
+
+uint64_t iteration_seed(uint64_t worker, uint64_t iteration) noexcept
+{
+  // counter based, so any iteration can be reached without running the
+  // ones before it; seed() expands it with splitmix64
+  return mix64(mix64(get_seed() + worker * 0x9e3779b97f4a7c15) + iteration);
 }
 
 std::uniform_real_distribution<> &get_uniform_distribution()
 {
-  static std::uniform_real_distribution<> distribution(-1.0, 1.0);
+  thread_local std::uniform_real_distribution<> distribution(-1.0, 1.0);
   return distribution;
 }
 
-template <> __attribute__((noinline)) int get_random<int>()
+template <> int get_random<int>()
 {
-  return std::rand();
+  return static_cast<int>(get_random_engine()() >> 33);
 }
 
 template <> float get_random<float>()
 {
-  std::mt19937 &random_engine = valfuzz::get_random_engine();
+  random_engine &engine = valfuzz::get_random_engine();
   std::uniform_real_distribution<> &uniform_distribution =
     valfuzz::get_uniform_distribution();
-  return static_cast<float>(uniform_distribution(random_engine));
+  return static_cast<float>(uniform_distribution(engine));
 }
 
 template <> double get_random<double>()
 {
-  std::mt19937 &random_engine = valfuzz::get_random_engine();
+  random_engine &engine = valfuzz::get_random_engine();
   std::uniform_real_distribution<> &uniform_distribution =
     valfuzz::get_uniform_distribution();
-  return static_cast<double>(uniform_distribution(random_engine));
+  return static_cast<double>(uniform_distribution(engine));
 }
 
 template <> char get_random<char>()
 {
-  return static_cast<char>(std::rand() % 256);
+  return static_cast<char>(get_random_engine()() >> 56);
 }
 
 template <> bool get_random<bool>()
 {
-  return static_cast<bool>(std::rand() % 2);
+  return static_cast<bool>(get_random_engine()() >> 63);
 }
 
 template <> std::string get_random<std::string>()
 {
-  int len = std::rand() % MAX_RANDOM_STRING_LEN;
-  std::string random_string = "";
-  for (int i = 0; i < len; i++)
+  std::string random_string;
+  generate_string(get_random_engine(), random_string,
+                  MAX_RANDOM_STRING_LEN - 1);
+  return random_string;
+}
+
+/**
+ * Four xoshiro256++ lanes laid out as a structure of arrays so that
+ * the compiler can turn each step into a few vector instructions.
+ */
+class random_engine_x4
+{
+public:
+  explicit random_engine_x4(random_engine &from) noexcept
   {
-    random_string += get_random<char>();
+    for (int i = 0; i < 4; i++)
+    {
+      random_engine lane(from());
+      lane_state[0][i] = lane();
+      lane_state[1][i] = lane();
+      lane_state[2][i] = lane();
+      lane_state[3][i] = lane();
+    }
+  }
+
+  void next(uint64_t *out) noexcept
+  {
+    uint64_t *s0 = lane_state[0];
+    uint64_t *s1 = lane_state[1];
+    uint64_t *s2 = lane_state[2];
+    uint64_t *s3 = lane_state[3];
+    for (int i = 0; i < 4; i++)
+    {
+      const uint64_t sum = s0[i] + s3[i];
+      out[i]             = ((sum << 23) | (sum >> 41)) + s0[i];
+      const uint64_t t   = s1[i] << 17;
+      s2[i] ^= s0[i];
+      s3[i] ^= s1[i];
+      s1[i] ^= s2[i];
+      s0[i] ^= s3[i];
+      s2[i] ^= t;
+      s3[i] = (s3[i] << 45) | (s3[i] >> 19);
+    }
+  }
+
+private:
+  alignas(32) uint64_t lane_state[4][4];
+};
+
+void get_random_bytes(void *out, size_t n)
+{
+  get_random_bytes(get_random_engine(), out, n);
+}
+
+void get_random_bytes(random_engine &engine, void *out, size_t n)
+{
+  unsigned char *dst = static_cast<unsigned char *>(out);
+  // not worth seeding the wide generator for a few words
+  if (n < 256)
+  {
+    while (n > 0)
+    {
+      uint64_t word = engine();
+      size_t len    = n < sizeof(word) ? n : sizeof(word);
+      std::memcpy(dst, &word, len);
+      dst += len;
+      n -= len;
+    }
+    return;
+  }
+
+  random_engine_x4 wide(engine);
+  alignas(32) uint64_t block[4];
+  while (n >= sizeof(block))
+  {
+    wide.next(block);
+    std::memcpy(dst, block, sizeof(block));
+    dst += sizeof(block);
+    n -= sizeof(block);
+  }
+  if (n > 0)
+  {
+    wide.next(block);
+    std::memcpy(dst, block, n);
+  }
+}
+
+template <> void get_random_fill<int>(int *out, size_t n)
+{
+  get_random_bytes(out, n * sizeof(int));
+  for (size_t i = 0; i < n; i++)
+  {
+    out[i] &= std::numeric_limits<int>::max();
+  }
+}
+
+template <> void get_random_fill<float>(float *out, size_t n)
+{
+  static_assert(sizeof(float) == sizeof(uint32_t));
+  get_random_bytes(out, n * sizeof(float));
+  for (size_t i = 0; i < n; i++)
+  {
+    uint32_t bits;
+    std::memcpy(&bits, &out[i], sizeof(bits));
+    // 24 random bits mapped to [-1, 1)
+    out[i] = static_cast<float>(bits >> 8) * 0x1.0p-23f - 1.0f;
+  }
+}
+
+template <> void get_random_fill<double>(double *out, size_t n)
+{
+  static_assert(sizeof(double) == sizeof(uint64_t));
+  get_random_bytes(out, n * sizeof(double));
+  for (size_t i = 0; i < n; i++)
+  {
+    uint64_t bits;
+    std::memcpy(&bits, &out[i], sizeof(bits));
+    // 53 random bits mapped to [-1, 1)
+    out[i] = static_cast<double>(bits >> 11) * 0x1.0p-52 - 1.0;
+  }
+}
+
+template <> void get_random_fill<char>(char *out, size_t n)
+{
+  get_random_bytes(out, n);
+}
+
+template <> void get_random_fill<unsigned char>(unsigned char *out, size_t n)
+{
+  get_random_bytes(out, n);
+}
+
+template <> void get_random_fill<bool>(bool *out, size_t n)
+{
+  unsigned char *bytes = reinterpret_cast<unsigned char *>(out);
+  get_random_bytes(bytes, n);
+  for (size_t i = 0; i < n; i++)
+  {
+    bytes[i] &= 1;
   }
-  return random_string;
 }
 
 std::deque<fuzz_pair> &get_fuzzs()
@@ -84,25 +309,116 @@ std::atomic<long unsigned int> &get_iterations()
   return iterations;
 }
 
-void increment_iterations()
+void add_iterations(long unsigned int n)
 {
-  auto &iterations = get_iterations();
-  iterations++;
+  // progress is printed by the stats reporter, not here
+  get_iterations().fetch_add(n, std::memory_order_relaxed);
 }
 
-std::optional<fuzz_pair> pop_fuzz_or_null()
+std::vector<std::unique_ptr<fuzz_worker>> &get_fuzz_workers()
 {
-  auto &fuzzs = get_fuzzs();
-  auto &fuzzs_mutex = get_tests_mutex();
+  static std::vector<std::unique_ptr<fuzz_worker>> fuzz_workers;
+  return fuzz_workers;
+}
+
+std::atomic<long unsigned int> &get_fuzz_time()
+{
+#if __cplusplus >= 202002L // C++20
+  constinit
+#endif
+    static std::atomic<long unsigned int>
+      fuzz_time = 0;
+  return fuzz_time;
+}
+
+std::atomic<long unsigned int> &get_fuzz_runs()
+{
+#if __cplusplus >= 202002L // C++20
+  constinit
+#endif
+    static std::atomic<long unsigned int>
+      fuzz_runs = 0;
+  return fuzz_runs;
+}
+
+void set_fuzz_time(long unsigned int seconds)
+{
+  auto &fuzz_time = get_fuzz_time();
+  fuzz_time       = seconds;
+}
+
+void set_fuzz_runs(long unsigned int runs)
+{
+  auto &fuzz_runs = get_fuzz_runs();
+  fuzz_runs       = runs;
+}
+
+static std::chrono::steady_clock::time_point &get_fuzz_deadline()
+{
+  static std::chrono::steady_clock::time_point fuzz_deadline;
+  return fuzz_deadline;
+}
+
+void start_fuzz_budget()
+{
+  get_fuzz_deadline() =
+    std::chrono::steady_clock::now() + std::chrono::seconds(get_fuzz_time());
+}
+
+static std::atomic<bool> fuzz_stop_requested = false;
+
+void request_fuzz_stop() noexcept
+{
+  fuzz_stop_requested.store(true);
+}
+
+bool fuzz_budget_exhausted()
+{
+  if (fuzz_stop_requested.load(std::memory_order_relaxed))
+    return true;
+  // the deadline is set before isolated workers are forked, and the
+  // monotonic clock is the same in every process
+  if (get_fuzz_time() > 0 &&
+      std::chrono::steady_clock::now() >= get_fuzz_deadline())
+    return true;
+  return get_fuzz_runs() > 0 && get_iterations() >= get_fuzz_runs();
+}
+
+std::deque<corpus_entry> &get_corpus()
+{
+  static std::deque<corpus_entry> corpus;
+  return corpus;
+}
+
+std::mutex &get_corpus_mutex()
+{
+#if __cplusplus >= 202002L // C++20
+  constinit
+#endif
+    static std::mutex corpus_mutex;
+  return corpus_mutex;
+}
 
-  std::lock_guard<std::mutex> lock(fuzzs_mutex);
-  if (fuzzs.empty())
+long unsigned int get_corpus_size()
+{
+  std::lock_guard<std::mutex> lock(get_corpus_mutex());
+  return get_corpus().size();
+}
+
+void add_to_corpus(const corpus_entry &entry)
+{
+  if (get_corpus_dir().has_value())
   {
-    return std::nullopt;
+    save_input(target_corpus_dir(get_corpus_dir().value(),
+                                 get_fuzzs()[entry.target].first),
+               entry.data.data(), entry.data.size());
   }
-  valfuzz::test_pair test = fuzzs.front();
-  fuzzs.pop_front();
-  return test;
+  // isolated workers also send it to the parent, which passes it on
+  // to the workers it forks later
+  if (get_isolated_slot() != nullptr)
+    get_isolated_slot()->push(entry);
+  std::lock_guard<std::mutex> lock(get_corpus_mutex());
+  get_corpus().push_back(entry);
 }
 
 void add_fuzz_test(const std::string &name, fuzz_function fuzz)
@@ -121,11 +437,7 @@ void run_one_fuzz(const std::string &name)
                 {
                   if (fuzz.first == name)
                   {
-                    for (long unsigned int i = 0; i < get_max_num_threads();
-                         i++)
-                    {
-                      the_fuzz.push_back(fuzz);
-                    }
+                    the_fuzz.push_back(fuzz);
                   }
                 });
   if (the_fuzz.empty())
@@ -141,50 +453,342 @@ void run_one_fuzz(const std::string &name)
   }
 }
 
-void _run_fuzz_tests()
+void make_fuzz_workers(long unsigned int num_workers)
 {
-  auto fuzz = std::optional<fuzz_pair>{};
-  while ((fuzz = pop_fuzz_or_null()).has_value())
+  auto &workers = get_fuzz_workers();
+  const size_t num_fuzzs = get_fuzzs().size();
+  workers.clear();
+  for (long unsigned int i = 0; i < num_workers; i++)
   {
-    if (get_verbose())
+    auto worker = std::make_unique<fuzz_worker>();
+    worker->id  = i;
+    // the scheduler decides which targets get the most batches
+    for (size_t t = 0; t < num_fuzzs; t++)
     {
-      std::lock_guard<std::mutex> lock(get_stream_mutex());
-      std::cout << "Running fuzz: \"" << fuzz.value().first << "\"\n";
+      worker->targets.push_back(t);
     }
-    fuzz.value().second(fuzz.value().first);
+    worker->energies.assign(num_fuzzs, SCHEDULER_MAX_ENERGY);
+    workers.push_back(std::move(worker));
+  }
+  get_fuzz_stats().reset(num_workers, num_fuzzs);
+  perf_reset(num_fuzzs);
+  restore_checkpoint_workers();
+}
 
-    increment_iterations();
-    long unsigned int iterations = get_iterations();
-    if (iterations % 1000000 == 0)
+uint8_t *get_fuzz_input_buffer()
+{
+  thread_local std::unique_ptr<uint8_t[]> buffer =
+    std::make_unique<uint8_t[]>(MAX_FUZZ_INPUT_SIZE);
+  return buffer.get();
+}
+
+void sync_worker_corpus(fuzz_worker &worker)
+{
+  std::lock_guard<std::mutex> lock(get_corpus_mutex());
+  const auto &corpus = get_corpus();
+  worker.corpus.resize(get_fuzzs().size());
+  for (; worker.corpus_seen < corpus.size(); worker.corpus_seen++)
+  {
+    const corpus_entry &entry = corpus[worker.corpus_seen];
+    if (std::find(worker.targets.begin(), worker.targets.end(),
+                  entry.target) != worker.targets.end())
     {
-      std::lock_guard<std::mutex> lock(get_stream_mutex());
-      std::cout << "Iterations: " << iterations << "\n";
+      worker.corpus[entry.target].push_back(entry.data);
     }
+  }
+}
 
-    add_fuzz_test(fuzz.value().first, fuzz.value().second);
+/* Save the input of a failed iteration, or the part of it the
+ * target narrowed down, if it is the first of its failure bucket */
+static bool record_iteration_failure(const fuzz_worker &worker,
+                                     uint64_t iteration, size_t target,
+                                     const random_engine &state,
+                                     const uint8_t *data, size_t size)
+{
+  get_thread_has_failed() = false;
+  // failures that did not come from an assertion share a bucket
+  uint64_t signature = get_thread_failure_signature();
+  if (signature == 0)
+    signature = failure_signature(get_fuzzs()[target].first, "", 0);
+  get_thread_failure_signature() = 0;
+  auto &narrowed                 = get_thread_failing_input();
+  bool saved;
+  if (!narrowed.has_value())
+  {
+    saved = record_failure(target, signature, state, data, size);
+  }
+  else
+  {
+    saved = record_failure(target, signature, narrowed->engine,
+                           narrowed->data.data(), narrowed->data.size());
+    narrowed.reset();
   }
+  if (saved)
+  {
+    log_line(std::cerr) << "Worker " << worker.id << " failed at iteration "
+                        << iteration << " running \""
+                        << get_fuzzs()[target].first << "\"\n";
+  }
+  return saved;
 }
 
-void run_fuzz_tests()
+size_t run_fuzz_batch(fuzz_worker &worker, size_t target, bool guided)
 {
-  if (get_is_threaded())
+  const fuzz_pair &fuzz = get_fuzzs()[target];
+  const auto &seeds     = worker.corpus[target];
+  random_engine &engine = get_random_engine();
+  mutator &input_mutator = get_thread_mutator();
+  uint8_t *buffer       = get_fuzz_input_buffer();
+  isolated_slot *slot   = get_isolated_slot();
+  thread_local std::vector<uint8_t> input;
+  const perf_metric metric = get_perf_metric().load(std::memory_order_relaxed);
+  size_t finds = 0;
+
+  for (int i = 0; i < FUZZ_BATCH_SIZE; i++)
   {
-    auto &thread_pool = get_thread_pool();
-    // spawn threads
-    for (long unsigned int i = 0;
-         i < get_max_num_threads() && i < get_num_fuzz_tests(); i++)
+    // a stop request, like SIGINT, does not wait for the end of the batch
+    if (fuzz_stop_requested.load(std::memory_order_relaxed))
+      break;
+    const uint64_t iteration = worker.next_iteration++;
+    engine.seed(iteration_seed(worker.id, iteration));
+    if (slot != nullptr)
+      slot->iteration = iteration;
+
+    // mutate a known input three times out of four
+    if (!seeds.empty() && (engine() & 3) != 0)
     {
-      thread_pool.push_back(std::thread(_run_fuzz_tests));
+      input = seeds[engine() % seeds.size()];
+      input_mutator.mutate(input, MAX_FUZZ_INPUT_SIZE,
+                           &seeds[engine() % seeds.size()]);
+      data_provider provider(input.data(), input.size());
+      // the body may call get_random<T>() too
+      random_engine state = engine;
+      if (slot != nullptr)
+        slot->record_input((uint32_t) target, state, input.data(),
+                           input.size());
+      const uint64_t started = perf_read(metric);
+      fuzz.second(fuzz.first, provider);
+      const std::optional<uint64_t> cost =
+        perf_measure(started, perf_read(metric));
+      if (get_thread_has_failed())
+        finds += record_iteration_failure(worker, iteration, target, state,
+                                          input.data(), input.size());
+      bool keep = guided && coverage_update();
+      // nothing is measured without a metric or when the reading failed
+      if (cost.has_value())
+      {
+        if (perf_is_slow(metric, *cost))
+          record_slow_input(target, *cost, state, input.data(), input.size());
+        if (perf_update(target, *cost))
+          keep = true;
+      }
+      if (keep)
+      {
+        input_mutator.reward();
+        add_to_corpus({target, input});
+        finds++;
+      }
+      continue;
     }
-    for (auto &thread : get_thread_pool())
+
+    if (slot != nullptr)
+      slot->record_generated((uint32_t) target, engine);
+    data_provider provider(buffer, MAX_FUZZ_INPUT_SIZE, engine);
+    random_engine state = engine;
+    const uint64_t started = perf_read(metric);
+    fuzz.second(fuzz.first, provider);
+    const std::optional<uint64_t> cost =
+      perf_measure(started, perf_read(metric));
+    if (get_thread_has_failed())
+    {
+      provider.materialize();
+      finds += record_iteration_failure(worker, iteration, target, state,
+                                        provider.data(), provider.size());
+    }
+    bool keep = guided && coverage_update();
+    if (cost.has_value())
+    {
+      // every execution over the threshold, not only a new slowest one
+      if (perf_is_slow(metric, *cost))
+      {
+        provider.materialize();
+        record_slow_input(target, *cost, state, provider.data(),
+                          provider.size());
+      }
+      if (perf_update(target, *cost))
+        keep = true;
+    }
+    if (keep)
+    {
+      provider.materialize();
+      add_to_corpus(
+        {target, std::vector<uint8_t>(provider.data(),
+                                      provider.data() + provider.size())});
+      finds++;
+    }
+  }
+  return finds;
+}
+
+void _run_fuzz_tests(fuzz_worker &worker)
+{
+  const auto &fuzzs = get_fuzzs();
+  if (worker.targets.empty())
+    return;
+
+  // coverage is used only if the targets are instrumented
+  coverage_thread_init();
+  coverage_reset();
+  {
+    // the probe is an iteration too
+    const fuzz_pair &probe   = fuzzs[worker.targets.front()];
+    const uint64_t iteration = worker.next_iteration++;
+    get_random_engine().seed(iteration_seed(worker.id, iteration));
+    if (get_isolated_slot() != nullptr)
+    {
+      get_isolated_slot()->iteration = iteration;
+      get_isolated_slot()->record_generated((uint32_t) worker.targets.front(),
+                                            get_random_engine());
+    }
+    data_provider provider(get_fuzz_input_buffer(), MAX_FUZZ_INPUT_SIZE,
+                           get_random_engine());
+    random_engine state = get_random_engine();
+    probe.second(probe.first, provider);
+    // a failure must not be left for the first iteration of a batch
+    if (get_thread_has_failed())
+    {
+      provider.materialize();
+      record_iteration_failure(worker, iteration, worker.targets.front(),
+                               state, provider.data(), provider.size());
+    }
+  }
+  const bool guided = coverage_has_hits();
+  coverage_reset();
+  perf_metric edges = perf_metric::edges;
+  if (!guided && get_perf_metric().compare_exchange_strong(edges,
+                                                           perf_metric::time))
+  {
+    perf_init();
+    std::lock_guard<std::mutex> lock(get_stream_mutex());
+    std::cerr << "Edges are not counted without coverage instrumentation, "
+                 "measuring time instead\n";
+  }
+
+  // run the loaded seeds once so their coverage is not found again
+  sync_worker_corpus(worker);
+  if (guided)
+  {
+    for (size_t target : worker.targets)
+    {
+      for (const auto &seed : worker.corpus[target])
+      {
+        if (get_isolated_slot() != nullptr)
+        {
+          get_isolated_slot()->iteration = worker.next_iteration;
+          get_isolated_slot()->record_input((uint32_t) target,
+                                            get_random_engine(), seed.data(),
+                                            seed.size());
+        }
+        data_provider provider(seed.data(), seed.size());
+        random_engine state = get_random_engine();
+        fuzzs[target].second(fuzzs[target].first, provider);
+        if (get_thread_has_failed())
+          record_iteration_failure(worker, worker.next_iteration, target,
+                                   state, seed.data(), seed.size());
+        coverage_update();
+      }
+    }
+  }
+
+  scheduler target_scheduler(worker.targets.size());
+  for (size_t i = 0; i < worker.energies.size(); i++)
+  {
+    target_scheduler.set_energy(i, worker.energies[i]);
+  }
+  random_engine &engine = get_random_engine();
+  while (!fuzz_budget_exhausted())
+  {
+    const size_t next     = target_scheduler.next(engine);
+    const size_t target   = worker.targets[next];
+    const fuzz_pair &fuzz = fuzzs[target];
+    if (get_verbose())
+      log_line(std::cout) << "Running fuzz: \"" << fuzz.first << "\"\n";
+    sync_worker_corpus(worker);
+    const uint64_t first_iteration = worker.next_iteration;
+    target_scheduler.update(next, run_fuzz_batch(worker, target, guided));
+    // fewer than a batch if the campaign was stopped
+    const uint64_t ran = worker.next_iteration - first_iteration;
+    if (guided)
+    {
+      // operands of the comparisons the batch ran into
+      mutator &input_mutator = get_thread_mutator();
+      coverage_take_cmp_operands(
+        [&input_mutator](const uint8_t *token, size_t size)
+        { input_mutator.add_token(token, size); });
+    }
+
+    // only this worker writes its counter
+    worker.iterations.store(worker.iterations.load(std::memory_order_relaxed)
+                              + ran,
+                            std::memory_order_relaxed);
+    get_fuzz_stats().add(worker.id, target, ran);
+    if (get_isolated_slot() != nullptr)
+      get_isolated_slot()->iterations.fetch_add(ran,
+                                                std::memory_order_relaxed);
+    else
+      add_iterations(ran);
+
+    // only the energy of this batch's target changed
+    std::lock_guard<std::mutex> lock(worker.checkpoint_mutex);
+    worker.checkpoint_iteration = worker.next_iteration;
+    worker.energies[next]       = target_scheduler.energy(next);
+  }
+}
+
+void run_fuzz_tests()
+{
+  load_corpus();
+  load_seeds();
+  load_checkpoint();
+  perf_init();
+  start_fuzz_budget();
+  install_checkpoint_signals();
+  if (get_is_isolated())
+  {
+    run_isolated_fuzz_tests(get_is_threaded() ? get_max_num_threads().load()
+                                             : 1);
+  }
+  else if (get_is_threaded())
+  {
+    make_fuzz_workers(get_max_num_threads());
+    start_stats_thread();
+    // a worker runs its batches on one thread, its engine, mutator and
+    // coverage map are thread local
+    auto &thread_pool = get_thread_pool();
+    for (auto &worker : get_fuzz_workers())
     {
-      thread.join();
+      fuzz_worker *w = worker.get();
+      thread_pool.submit(
+        [w]()
+        {
+          seed_random_engine(w->id);
+          _run_fuzz_tests(*w);
+        });
     }
+    thread_pool.wait();
+    stop_stats_thread();
   }
   else
   {
-    _run_fuzz_tests();
+    make_fuzz_workers(1);
+    start_stats_thread();
+    _run_fuzz_tests(*get_fuzz_workers().front());
+    stop_stats_thread();
   }
+  log_drain();
+  report_failure_counts();
+  if (get_checkpoint_dir().has_value())
+    save_checkpoint();
 }
 
 } // namespace valfuzz
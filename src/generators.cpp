@@ -0,0 +1,28 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <valfuzz/generators.hpp>
+
+namespace valfuzz
+{
+
+void generate_string(random_engine &engine, std::string &out, size_t max_len)
+{
+  // resize keeps the capacity, so a reused string is not reallocated
+  out.resize(generate_below(engine, max_len + 1));
+  get_random_bytes(engine, out.data(), out.size());
+}
+
+void generate_string(random_engine &engine, std::string &out, size_t max_len,
+                     std::string_view alphabet)
+{
+  out.resize(alphabet.empty() ? 0 : generate_below(engine, max_len + 1));
+  for (char &c : out)
+  {
+    c = alphabet[generate_below(engine, alphabet.size())];
+  }
+}
+
+} // namespace valfuzz
@@ -0,0 +1,309 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <chrono>
+#include <cstdio>
+#include <new>
+#include <valfuzz/checkpoint.hpp>
+#include <valfuzz/coverage.hpp>
+#include <valfuzz/failures.hpp>
+#include <valfuzz/isolation.hpp>
+#include <valfuzz/stats.hpp>
+#include <valfuzz/test.hpp>
+
+#if defined(__linux__)
+#include <csignal>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace valfuzz
+{
+
+bool &get_is_isolated()
+{
+  static bool is_isolated = false;
+  return is_isolated;
+}
+
+isolated_slot *&get_isolated_slot()
+{
+  static isolated_slot *isolated_slot = nullptr;
+  return isolated_slot;
+}
+
+void set_is_isolated(bool is_isolated)
+{
+  auto &is_isolated_ref = get_is_isolated();
+  is_isolated_ref       = is_isolated;
+}
+
+static void ring_write(uint8_t *ring, uint64_t at, const void *data,
+                       size_t size)
+{
+  size_t offset = (size_t) (at % ISOLATED_RING_SIZE);
+  size_t first  = std::min(size, (size_t) ISOLATED_RING_SIZE - offset);
+  std::memcpy(ring + offset, data, first);
+  std::memcpy(ring, static_cast<const uint8_t *>(data) + first, size - first);
+}
+
+static void ring_read(const uint8_t *ring, uint64_t at, void *data,
+                      size_t size)
+{
+  size_t offset = (size_t) (at % ISOLATED_RING_SIZE);
+  size_t first  = std::min(size, (size_t) ISOLATED_RING_SIZE - offset);
+  std::memcpy(data, ring + offset, first);
+  std::memcpy(static_cast<uint8_t *>(data) + first, ring, size - first);
+}
+
+bool isolated_slot::push(const corpus_entry &entry) noexcept
+{
+  uint32_t header[2] = {(uint32_t) entry.target,
+                        (uint32_t) entry.data.size()};
+  const uint64_t need = sizeof(header) + ((entry.data.size() + 7) & ~7ul);
+  uint64_t head       = ring_head.load(std::memory_order_relaxed);
+  uint64_t tail       = ring_tail.load(std::memory_order_acquire);
+  if (ISOLATED_RING_SIZE - (head - tail) < need)
+    return false;
+  ring_write(ring, head, header, sizeof(header));
+  ring_write(ring, head + sizeof(header), entry.data.data(),
+             entry.data.size());
+  ring_head.store(head + need, std::memory_order_release);
+  return true;
+}
+
+bool isolated_slot::pop(corpus_entry &entry)
+{
+  uint64_t tail = ring_tail.load(std::memory_order_relaxed);
+  uint64_t head = ring_head.load(std::memory_order_acquire);
+  if (head == tail)
+    return false;
+  uint32_t header[2];
+  ring_read(ring, tail, header, sizeof(header));
+  entry.target = header[0];
+  entry.data.resize(header[1]);
+  ring_read(ring, tail + sizeof(header), entry.data.data(), header[1]);
+  ring_tail.store(tail + sizeof(header) + ((header[1] + 7) & ~7ul),
+                  std::memory_order_release);
+  return true;
+}
+
+reproducer slot_reproducer(const isolated_slot &slot)
+{
+  reproducer repro;
+  repro.target = get_fuzzs()[slot.target].first;
+  repro.engine.set_state(slot.engine_state);
+  if (!slot.generated)
+  {
+    repro.data.assign(slot.input, slot.input + slot.input_size);
+    return repro;
+  }
+
+  // the child generated it lazily, generate all of it again
+  std::vector<uint8_t> buffer(MAX_FUZZ_INPUT_SIZE);
+  data_provider provider(buffer.data(), buffer.size(), repro.engine);
+  provider.materialize();
+  repro.data.assign(provider.data(), provider.data() + provider.size());
+  return repro;
+}
+
+#if defined(__linux__)
+
+static void on_crash_signal(int signal)
+{
+  isolated_slot *slot = get_isolated_slot();
+  if (slot != nullptr)
+    slot->backtrace = backtrace_signature();
+  // the handler was reset, the signal kills the child
+  raise(signal);
+}
+
+static void install_crash_handlers()
+{
+  static uint8_t stack[1 << 16];
+  stack_t alternate;
+  alternate.ss_sp    = stack;
+  alternate.ss_size  = sizeof(stack);
+  alternate.ss_flags = 0;
+  // a stack overflow can still be hashed
+  sigaltstack(&alternate, nullptr);
+
+  // not in the handler, it takes the loader lock
+  backtrace_init();
+  struct sigaction action;
+  std::memset(&action, 0, sizeof(action));
+  action.sa_handler = on_crash_signal;
+  action.sa_flags   = SA_RESETHAND | SA_NODEFER | SA_ONSTACK;
+  for (int signal : {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT})
+  {
+    sigaction(signal, &action, nullptr);
+  }
+}
+
+static pid_t spawn_worker(fuzz_worker &worker, isolated_slot &slot)
+{
+  // buffered output would be printed by both processes
+  std::cout.flush();
+  std::cerr.flush();
+  std::fflush(nullptr);
+
+  slot.target    = ISOLATED_NO_INPUT;
+  slot.backtrace = 0;
+  pid_t pid      = fork();
+  if (pid != 0)
+    return pid;
+
+  // do not outlive the parent
+  prctl(PR_SET_PDEATHSIG, SIGKILL);
+  get_isolated_slot() = &slot;
+  // the parent marks its own thread failed when a child crashes
+  get_thread_has_failed()        = false;
+  get_thread_failure_signature() = 0;
+  install_crash_handlers();
+  seed_random_engine(worker.id);
+  _run_fuzz_tests(worker);
+  log_drain();
+  std::cout.flush();
+  std::cerr.flush();
+  _exit(get_has_failed_once() ? 1 : 0);
+}
+
+static void drain_slot(isolated_slot &slot)
+{
+  corpus_entry entry;
+  std::lock_guard<std::mutex> lock(get_corpus_mutex());
+  while (slot.pop(entry))
+  {
+    // already saved to disk by the child
+    get_corpus().push_back(std::move(entry));
+  }
+}
+
+void run_isolated_fuzz_tests(long unsigned int num_workers)
+{
+  make_fuzz_workers(num_workers);
+  auto &workers = get_fuzz_workers();
+  void *memory  = mmap(nullptr, sizeof(isolated_slot) * workers.size(),
+                       PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+                       -1, 0);
+  if (memory == MAP_FAILED)
+  {
+    std::lock_guard<std::mutex> lock(get_stream_mutex());
+    std::cerr << "Could not map memory for isolated workers\n";
+    std::exit(1);
+  }
+  isolated_slot *slots = static_cast<isolated_slot *>(memory);
+  coverage_share_global_map();
+  failures_share();
+
+  std::vector<pid_t> pids(workers.size());
+  std::vector<long unsigned int> seen(workers.size(), 0);
+  for (size_t i = 0; i < workers.size(); i++)
+  {
+    new (&slots[i]) isolated_slot();
+    pids[i] = spawn_worker(*workers[i], slots[i]);
+  }
+
+  // no stats thread, it could hold a lock while a worker is forked
+  stats_reporter reporter;
+  bool stopping = false;
+  size_t alive  = workers.size();
+  while (alive > 0)
+  {
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+      drain_slot(slots[i]);
+      long unsigned int iterations =
+        slots[i].iterations.load(std::memory_order_relaxed);
+      add_iterations(iterations - seen[i]);
+      seen[i] = iterations;
+      if (slots[i].target != ISOLATED_NO_INPUT)
+      {
+        // a checkpoint resumes after the iteration the child is running
+        std::lock_guard<std::mutex> lock(workers[i]->checkpoint_mutex);
+        workers[i]->checkpoint_iteration = std::max(
+          workers[i]->checkpoint_iteration, slots[i].iteration + 1);
+      }
+    }
+    if (!stopping && fuzz_budget_exhausted())
+    {
+      stopping = true;
+      for (pid_t worker_pid : pids)
+      {
+        if (worker_pid > 0)
+          kill(worker_pid, SIGKILL);
+      }
+    }
+
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+    {
+      size_t i = (size_t) (std::find(pids.begin(), pids.end(), pid) -
+                           pids.begin());
+      if (i == pids.size())
+        continue;
+      drain_slot(slots[i]);
+      if (!WIFSIGNALED(status) ||
+          (stopping && WTERMSIG(status) == SIGKILL))
+      {
+        // the worker stopped by itself or at the end of the budget
+        if (WIFEXITED(status) && WEXITSTATUS(status) != 0)
+          set_has_failed_once(true);
+        pids[i] = -1;
+        alive--;
+        continue;
+      }
+
+      set_has_failed_once(true);
+      if (slots[i].target != ISOLATED_NO_INPUT)
+      {
+        reproducer repro = slot_reproducer(slots[i]);
+        const uint64_t signature =
+          crash_signature(repro.target, WTERMSIG(status), slots[i].backtrace);
+        // report only the first crash of each bucket
+        if (count_crash(signature, repro.target, WTERMSIG(status)) &&
+            record_failure(slots[i].target, signature, repro.engine,
+                           repro.data.data(), repro.data.size()))
+        {
+          std::lock_guard<std::mutex> lock(get_stream_mutex());
+          std::cerr << "Worker " << i << " killed by signal "
+                    << WTERMSIG(status) << " at iteration "
+                    << slots[i].iteration << " running \"" << repro.target
+                    << "\"\n";
+        }
+      }
+      if (stopping)
+      {
+        pids[i] = -1;
+        alive--;
+        continue;
+      }
+      // the new child goes on after the iteration that crashed
+      workers[i]->next_iteration = slots[i].iteration + 1;
+      pids[i] = spawn_worker(*workers[i], slots[i]);
+    }
+    reporter.poll();
+    checkpoint_poll();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  reporter.report();
+  munmap(memory, sizeof(isolated_slot) * workers.size());
+}
+
+#else
+
+void run_isolated_fuzz_tests(long unsigned int)
+{
+  std::lock_guard<std::mutex> lock(get_stream_mutex());
+  std::cerr << "Isolated mode is only supported on Linux\n";
+  std::exit(1);
+}
+
+#endif // __linux__
+
+} // namespace valfuzz
@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <valfuzz/data_provider.hpp>
+#include <valfuzz/fuzz.hpp>
+#include <valfuzz/libfuzzer.hpp>
+
+namespace valfuzz
+{
+
+void libfuzzer_initialize(int *argc, char ***argv)
+{
+  if (LLVMFuzzerInitialize != nullptr)
+    LLVMFuzzerInitialize(argc, argv);
+}
+
+bool register_libfuzzer_target()
+{
+  if (LLVMFuzzerTestOneInput == nullptr)
+    return false;
+  add_fuzz_test(LIBFUZZER_TARGET_NAME,
+                [](const std::string &, data_provider &provider)
+                {
+                  std::string_view input = provider.consume_remaining();
+                  LLVMFuzzerTestOneInput(
+                    reinterpret_cast<const uint8_t *>(input.data()),
+                    input.size());
+                });
+  return true;
+}
+
+} // namespace valfuzz
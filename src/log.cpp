@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <cstdlib>
+#include <mutex>
+#include <valfuzz/common.hpp>
+#include <valfuzz/log.hpp>
+
+namespace valfuzz
+{
+
+/* The lines of a thread that were not pushed yet */
+struct thread_log
+{
+  std::ostringstream text;
+  log_batch         *batch   = nullptr;
+  bool               grouped = false;
+};
+
+static thread_log &get_thread_log()
+{
+  thread_local thread_log log;
+  return log;
+}
+
+/* Batches pushed and not written, newest first */
+static std::atomic<log_batch *> &get_log_head()
+{
+#if __cplusplus >= 202002L // C++20
+  constinit
+#endif
+    static std::atomic<log_batch *>
+      log_head = nullptr;
+  return log_head;
+}
+
+static std::mutex &get_log_writer_mutex()
+{
+#if __cplusplus >= 202002L // C++20
+  constinit
+#endif
+    static std::mutex log_writer_mutex;
+  return log_writer_mutex;
+}
+
+/* Write and free a list taken from the head, with the writer mutex */
+static void write_batches(log_batch *list)
+{
+  if (list == nullptr)
+    return;
+  // pushed newest first, written oldest first
+  log_batch *ordered = nullptr;
+  while (list != nullptr)
+  {
+    log_batch *next = list->next;
+    list->next      = ordered;
+    ordered         = list;
+    list            = next;
+  }
+  std::lock_guard<std::mutex> lock(get_stream_mutex());
+  while (ordered != nullptr)
+  {
+    for (auto &[target, text] : ordered->segments)
+    {
+      *target << text;
+      target->flush();
+    }
+    log_batch *next = ordered->next;
+    delete ordered;
+    ordered = next;
+  }
+}
+
+/* Write the pushed batches, unless another thread is writing them */
+static void log_try_drain()
+{
+  auto &head = get_log_head();
+  // the writer looks at the head again after unlocking, so what was
+  // pushed while it wrote is not left behind
+  while (head.load() != nullptr && get_log_writer_mutex().try_lock())
+  {
+    write_batches(head.exchange(nullptr));
+    get_log_writer_mutex().unlock();
+  }
+}
+
+/* Write everything pushed so far, waiting for the writer */
+static void log_drain_pushed()
+{
+  std::lock_guard<std::mutex> lock(get_log_writer_mutex());
+  write_batches(get_log_head().exchange(nullptr));
+}
+
+static void log_push(log_batch *batch)
+{
+  // lines pushed and not written when the process exits. Not
+  // log_drain: exit destroys the thread_local log of the caller before
+  // it runs the atexit handlers
+  static const bool drain_at_exit = (std::atexit(log_drain_pushed) == 0);
+  (void) drain_at_exit;
+
+  auto &head = get_log_head();
+  batch->next = head.load();
+  while (!head.compare_exchange_weak(batch->next, batch))
+  {
+  }
+  log_try_drain();
+}
+
+log_line::log_line(std::ostream &target)
+  : target(target), text(get_thread_log().text)
+{
+}
+
+log_line::~log_line()
+{
+  thread_log &log = get_thread_log();
+  if (log.batch == nullptr)
+    log.batch = new log_batch();
+  auto &segments = log.batch->segments;
+  if (!segments.empty() && segments.back().first == &target)
+    segments.back().second += text.str();
+  else
+    segments.emplace_back(&target, text.str());
+  text.str("");
+  // failures are pushed at once, with the lines held before them, so
+  // they are printed even if the test then crashes or hangs
+  if (!log.grouped || &target == &std::cerr)
+  {
+    log_push(log.batch);
+    log.batch = nullptr;
+  }
+}
+
+log_line &log_line::operator<<(std::ostream &(*manipulator)(std::ostream &))
+{
+  text << manipulator;
+  return *this;
+}
+
+void log_begin_group()
+{
+  get_thread_log().grouped = true;
+}
+
+void log_end_group()
+{
+  thread_log &log = get_thread_log();
+  log.grouped     = false;
+  if (log.batch != nullptr)
+  {
+    log_push(log.batch);
+    log.batch = nullptr;
+  }
+}
+
+void log_drain()
+{
+  thread_log &log = get_thread_log();
+  if (log.batch != nullptr)
+  {
+    log_push(log.batch);
+    log.batch = nullptr;
+  }
+  log_drain_pushed();
+}
+
+} // namespace valfuzz
@@ -0,0 +1,269 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <valfuzz/data_provider.hpp>
+#include <valfuzz/minimizer.hpp>
+#include <valfuzz/test.hpp>
+
+namespace valfuzz
+{
+
+std::optional<std::filesystem::path> &get_minimize_file()
+{
+  static std::optional<std::filesystem::path> minimize_file = std::nullopt;
+  return minimize_file;
+}
+
+void set_minimize_file(const std::filesystem::path &file)
+{
+  auto &minimize_file = get_minimize_file();
+  minimize_file       = file;
+}
+
+void apply_candidate(const std::vector<uint8_t> &input,
+                     const minimize_candidate &candidate,
+                     std::vector<uint8_t> &out)
+{
+  out.assign(input.begin(), input.end());
+  if (candidate.value >= 0)
+    out[candidate.begin] = (uint8_t) candidate.value;
+  else
+    out.erase(out.begin() + (std::ptrdiff_t) candidate.begin,
+              out.begin() + (std::ptrdiff_t) candidate.end);
+}
+
+/**
+ * Evaluates the candidates of a round on the thread pool. Candidates
+ * are taken in order from a shared counter; once one fails, the ones
+ * after it are skipped
+ */
+class candidate_runner
+{
+public:
+  candidate_runner(const minimize_predicate &fails, size_t num_threads)
+    : fails(fails), num_threads(num_threads)
+  {
+  }
+
+  /* Index of the first failing candidate, or candidates.size() */
+  size_t first_failing(const std::vector<uint8_t> &input,
+                       const std::vector<minimize_candidate> &candidates)
+  {
+    if (candidates.empty())
+      return 0;
+    round_input      = &input;
+    round_candidates = &candidates;
+    next.store(0);
+    found.store(candidates.size());
+    if (num_threads <= 1)
+      work();
+    else
+      get_thread_pool().parallel_for(num_threads,
+                                     [this](size_t, size_t) { work(); });
+    return found.load();
+  }
+
+  size_t runs() const
+  {
+    return num_runs.load();
+  }
+
+private:
+  void work()
+  {
+    const auto &candidates = *round_candidates;
+    std::vector<uint8_t> buffer;
+    size_t i;
+    while ((i = next.fetch_add(1)) < candidates.size() && i < found.load())
+    {
+      apply_candidate(*round_input, candidates[i], buffer);
+      num_runs.fetch_add(1, std::memory_order_relaxed);
+      if (!fails(buffer))
+        continue;
+      size_t first = found.load();
+      while (i < first && !found.compare_exchange_weak(first, i))
+      {
+      }
+    }
+  }
+
+  const minimize_predicate &fails;
+  const size_t num_threads;
+  const std::vector<uint8_t> *round_input                  = nullptr;
+  const std::vector<minimize_candidate> *round_candidates = nullptr;
+  std::atomic<size_t> next     = 0;
+  std::atomic<size_t> found    = 0;
+  std::atomic<size_t> num_runs = 0;
+};
+
+/* Delta debugging, a window of chunks at a time from the start of the
+ * input. After a removal the same position holds the next chunk */
+static bool remove_chunks(std::vector<uint8_t> &data, candidate_runner &runner,
+                          size_t window)
+{
+  std::vector<minimize_candidate> candidates;
+  std::vector<uint8_t> reduced;
+  bool changed = false;
+  size_t chunk = std::max<size_t>(data.size() / 2, 1);
+  while (!data.empty())
+  {
+    bool removed = false;
+    size_t begin = 0;
+    while (begin < data.size())
+    {
+      candidates.clear();
+      for (size_t b = begin; b < data.size() && candidates.size() < window;
+           b += chunk)
+      {
+        candidates.push_back({b, std::min(b + chunk, data.size()), -1});
+      }
+      size_t found = runner.first_failing(data, candidates);
+      if (found == candidates.size())
+      {
+        begin = candidates.back().end;
+        continue;
+      }
+      begin = candidates[found].begin;
+      apply_candidate(data, candidates[found], reduced);
+      data.swap(reduced);
+      removed = changed = true;
+    }
+    if (!removed)
+    {
+      if (chunk == 1)
+        break;
+      chunk /= 2;
+    }
+  }
+  return changed;
+}
+
+/* Lower every byte to zero, or else to half its value */
+static bool lower_bytes(std::vector<uint8_t> &data, candidate_runner &runner,
+                        size_t window)
+{
+  std::vector<minimize_candidate> candidates;
+  std::vector<uint8_t> reduced;
+  bool changed = false;
+  size_t pos   = 0;
+  while (pos < data.size())
+  {
+    candidates.clear();
+    size_t end = pos;
+    for (; end < data.size() && candidates.size() < window; end++)
+    {
+      if (data[end] != 0)
+        candidates.push_back({end, end + 1, 0});
+      if (data[end] > 1)
+        candidates.push_back({end, end + 1, data[end] / 2});
+    }
+    size_t found = runner.first_failing(data, candidates);
+    if (found == candidates.size())
+    {
+      pos = end;
+      continue;
+    }
+    // the byte may be lowered again
+    pos = candidates[found].begin;
+    apply_candidate(data, candidates[found], reduced);
+    data.swap(reduced);
+    changed = true;
+  }
+  return changed;
+}
+
+std::vector<uint8_t> minimize_input(std::vector<uint8_t> data,
+                                    const minimize_predicate &fails,
+                                    size_t num_threads, size_t *runs)
+{
+  num_threads = std::max<size_t>(num_threads, 1);
+  const size_t window = num_threads * MINIMIZE_CANDIDATES_PER_THREAD;
+  {
+    candidate_runner runner(fails, num_threads);
+    bool changed = true;
+    while (changed)
+    {
+      changed = remove_chunks(data, runner, window);
+      changed = lower_bytes(data, runner, window) || changed;
+    }
+    if (runs != nullptr)
+      *runs = runner.runs();
+  }
+  return data;
+}
+
+void minimize_fuzz(const std::filesystem::path &path)
+{
+  auto repro = read_reproducer(path);
+  if (!repro.has_value())
+  {
+    std::lock_guard<std::mutex> lock(get_stream_mutex());
+    std::cerr << "Could not read reproducer " << path << "\n";
+    std::exit(1);
+  }
+  const auto &fuzzs = get_fuzzs();
+  auto fuzz         = std::find_if(fuzzs.begin(), fuzzs.end(),
+                                   [&repro](const fuzz_pair &f)
+                                   { return f.first == repro->target; });
+  if (fuzz == fuzzs.end())
+  {
+    std::lock_guard<std::mutex> lock(get_stream_mutex());
+    std::cerr << "Fuzz test \"" << repro->target << "\" not found\n";
+    std::exit(1);
+  }
+
+  const random_engine state = repro->engine;
+  minimize_predicate fails  = [&fuzz, &state](const std::vector<uint8_t> &input)
+  {
+    get_thread_has_failed() = false;
+    get_random_engine()     = state;
+    data_provider provider(input.data(), input.size());
+    fuzz->second(fuzz->first, provider);
+    get_thread_failing_input().reset();
+    return get_thread_has_failed();
+  };
+
+  {
+    std::lock_guard<std::mutex> lock(get_stream_mutex());
+    std::cout << "Minimizing " << path << " on \"" << repro->target << "\" ("
+              << repro->data.size() << " bytes)" << std::endl;
+  }
+  // the assertions of every failing candidate would flood the output
+  std::streambuf *cerr_buffer;
+  {
+    std::lock_guard<std::mutex> lock(get_stream_mutex());
+    cerr_buffer = std::cerr.rdbuf(nullptr);
+  }
+  const bool original_fails = fails(repro->data);
+  size_t runs               = 1;
+  std::vector<uint8_t> minimized;
+  if (original_fails)
+  {
+    const size_t num_threads =
+      get_is_threaded() ? get_max_num_threads().load() : 1;
+    minimized = minimize_input(repro->data, fails, num_threads, &runs);
+    runs++;
+  }
+  {
+    std::lock_guard<std::mutex> lock(get_stream_mutex());
+    std::cerr.rdbuf(cerr_buffer);
+  }
+  if (!original_fails)
+  {
+    std::lock_guard<std::mutex> lock(get_stream_mutex());
+    std::cerr << "Reproducer " << path << " does not fail\n";
+    std::exit(1);
+  }
+  // the failures were expected, the run succeeded
+  set_has_failed_once(false);
+
+  std::filesystem::path saved =
+    save_reproducer({repro->target, state, minimized});
+  std::lock_guard<std::mutex> lock(get_stream_mutex());
+  std::cout << "Minimized to " << minimized.size() << " bytes in " << runs
+            << " runs, saved " << saved.string() << "\n";
+}
+
+} // namespace valfuzz
@@ -0,0 +1,253 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <cstring>
+#include <valfuzz/mutator.hpp>
+
+namespace valfuzz
+{
+
+#define ARITHMETIC_MAX 35
+#define MAX_BLOCK_SIZE 32
+
+static const uint64_t interesting_values[] = {
+  0,          1,          16,         32,         64,
+  100,        127,        128,        255,        256,
+  512,        1000,       1024,       4096,       32767,
+  32768,      65535,      65536,      0x7fffffff, 0x80000000,
+  0xffffffff, 0x7fffffffffffffff,     0x8000000000000000,
+  0xffffffffffffffff,     0xfffffffffffffffe,     0xffffffffffffff80,
+  0xffffffffffff8000,     0xffffffff80000000};
+
+mutator &get_thread_mutator()
+{
+  thread_local mutator thread_mutator(get_random_engine());
+  return thread_mutator;
+}
+
+std::string mutation_name(mutation m)
+{
+  switch (m)
+  {
+  case mutation::bit_flip:
+    return "bit flip";
+  case mutation::byte_flip:
+    return "byte flip";
+  case mutation::interesting_value:
+    return "interesting value";
+  case mutation::arithmetic:
+    return "arithmetic";
+  case mutation::insert_block:
+    return "insert block";
+  case mutation::delete_block:
+    return "delete block";
+  case mutation::duplicate_block:
+    return "duplicate block";
+  case mutation::splice:
+    return "splice";
+  case mutation::dictionary:
+    return "dictionary";
+  default:
+    return "unknown";
+  }
+}
+
+void mutator::add_token(const uint8_t *token, size_t size)
+{
+  if (size == 0 || size > MAX_BLOCK_SIZE)
+    return;
+  for (const auto &t : dictionary)
+  {
+    if (t.size() == size && std::memcmp(t.data(), token, size) == 0)
+      return;
+  }
+  if (dictionary.size() < MAX_DICTIONARY_SIZE)
+  {
+    dictionary.emplace_back(token, token + size);
+  }
+  else
+  {
+    dictionary[below(dictionary.size())].assign(token, token + size);
+  }
+}
+
+mutation mutator::pick_operator()
+{
+  // weight is the smoothed success rate of each operator, so that
+  // operators that never pay off are still tried once in a while
+  double weights[(size_t) mutation::count];
+  double total = 0.0;
+  for (size_t i = 0; i < (size_t) mutation::count; i++)
+  {
+    weights[i] = ((double) operator_successes[i] + 1.0) /
+                 ((double) operator_uses[i] + 2.0);
+    total += weights[i];
+  }
+  double pick = (double) (engine() >> 11) * 0x1.0p-53 * total;
+  for (size_t i = 0; i < (size_t) mutation::count; i++)
+  {
+    if (pick < weights[i])
+      return (mutation) i;
+    pick -= weights[i];
+  }
+  return mutation::bit_flip;
+}
+
+void mutator::mutate(std::vector<uint8_t> &data, size_t max_size,
+                     const std::vector<uint8_t> *other)
+{
+  // forget old statistics slowly so the scheduler follows the target
+  if (++total_uses % 65536 == 0)
+  {
+    for (size_t i = 0; i < (size_t) mutation::count; i++)
+    {
+      operator_uses[i] /= 2;
+      operator_successes[i] /= 2;
+    }
+  }
+
+  last_stack_size = 0;
+  size_t stack    = 1 + below(MAX_MUTATION_STACK);
+  for (size_t attempts = 0; last_stack_size < stack && attempts < stack * 4;
+       attempts++)
+  {
+    mutation m = pick_operator();
+    if (mutate_with(m, data, max_size, other))
+    {
+      operator_uses[(size_t) m]++;
+      last_stack[last_stack_size++] = m;
+    }
+  }
+}
+
+void mutator::reward()
+{
+  for (size_t i = 0; i < last_stack_size; i++)
+  {
+    operator_successes[(size_t) last_stack[i]]++;
+  }
+  last_stack_size = 0;
+}
+
+bool mutator::mutate_with(mutation m, std::vector<uint8_t> &data,
+                          size_t max_size, const std::vector<uint8_t> *other)
+{
+  const size_t size = data.size();
+  switch (m)
+  {
+  case mutation::bit_flip:
+  {
+    if (size == 0)
+      return false;
+    data[below(size)] ^= (uint8_t) (1u << below(8));
+    return true;
+  }
+  case mutation::byte_flip:
+  {
+    if (size == 0)
+      return false;
+    data[below(size)] ^= (uint8_t) (1 + below(255));
+    return true;
+  }
+  case mutation::interesting_value:
+  {
+    size_t width = (size_t) 1 << below(4);
+    if (size < width)
+      return false;
+    uint64_t value = interesting_values[below(sizeof(interesting_values) /
+                                              sizeof(interesting_values[0]))];
+    if (below(2))
+      value = __builtin_bswap64(value) >> (64 - width * 8);
+    std::memcpy(data.data() + below(size - width + 1), &value, width);
+    return true;
+  }
+  case mutation::arithmetic:
+  {
+    size_t width = (size_t) 1 << below(4);
+    if (size < width)
+      return false;
+    size_t pos     = below(size - width + 1);
+    uint64_t value = 0;
+    std::memcpy(&value, data.data() + pos, width);
+    uint64_t delta = 1 + below(ARITHMETIC_MAX);
+    value          = below(2) ? value + delta : value - delta;
+    std::memcpy(data.data() + pos, &value, width);
+    return true;
+  }
+  case mutation::insert_block:
+  {
+    if (size >= max_size)
+      return false;
+    size_t len = 1 + below(std::min<size_t>(MAX_BLOCK_SIZE, max_size - size));
+    size_t pos = below(size + 1);
+    data.insert(data.begin() + (long) pos, len, 0);
+    if (below(2))
+    {
+      get_random_bytes(data.data() + pos, len);
+    }
+    else
+    {
+      std::memset(data.data() + pos, (int) below(256), len);
+    }
+    return true;
+  }
+  case mutation::delete_block:
+  {
+    if (size < 2)
+      return false;
+    size_t len = 1 + below(std::min<size_t>(MAX_BLOCK_SIZE, size - 1));
+    size_t pos = below(size - len + 1);
+    data.erase(data.begin() + (long) pos, data.begin() + (long) (pos + len));
+    return true;
+  }
+  case mutation::duplicate_block:
+  {
+    if (size == 0 || size >= max_size)
+      return false;
+    size_t len  = 1 + below(std::min<size_t>(
+                   {(size_t) MAX_BLOCK_SIZE, size, max_size - size}));
+    size_t from = below(size - len + 1);
+    size_t to   = below(size + 1);
+    std::vector<uint8_t> block(data.begin() + (long) from,
+                               data.begin() + (long) (from + len));
+    data.insert(data.begin() + (long) to, block.begin(), block.end());
+    return true;
+  }
+  case mutation::splice:
+  {
+    if (other == nullptr || other->empty() || other == &data)
+      return false;
+    size_t cut       = below(size + 1);
+    size_t other_cut = below(other->size());
+    size_t len       = std::min(other->size() - other_cut, max_size - cut);
+    data.resize(cut);
+    data.insert(data.end(), other->begin() + (long) other_cut,
+                other->begin() + (long) (other_cut + len));
+    return true;
+  }
+  case mutation::dictionary:
+  {
+    if (dictionary.empty())
+      return false;
+    const auto &token = dictionary[below(dictionary.size())];
+    if (below(2) && size >= token.size())
+    {
+      // overwrite
+      std::memcpy(data.data() + below(size - token.size() + 1), token.data(),
+                  token.size());
+      return true;
+    }
+    if (size + token.size() > max_size)
+      return false;
+    data.insert(data.begin() + (long) below(size + 1), token.begin(),
+                token.end());
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+} // namespace valfuzz
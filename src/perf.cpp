@@ -0,0 +1,240 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <valfuzz/coverage.hpp>
+#include <valfuzz/perf.hpp>
+#include <valfuzz/reproducer.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace valfuzz
+{
+
+std::atomic<perf_metric> &get_perf_metric()
+{
+#if __cplusplus >= 202002L // C++20
+  constinit
+#endif
+    static std::atomic<perf_metric>
+      metric = perf_metric::none;
+  return metric;
+}
+
+std::atomic<double> &get_slow_input_threshold()
+{
+#if __cplusplus >= 202002L // C++20
+  constinit
+#endif
+    static std::atomic<double>
+      threshold = 0.0;
+  return threshold;
+}
+
+void set_perf_metric(perf_metric metric)
+{
+  auto &metric_ref = get_perf_metric();
+  metric_ref       = metric;
+}
+
+void set_slow_input_threshold(double threshold)
+{
+  auto &threshold_ref = get_slow_input_threshold();
+  threshold_ref       = threshold;
+}
+
+std::optional<perf_metric> parse_perf_metric(const std::string &name)
+{
+  if (name == "time")
+    return perf_metric::time;
+  if (name == "edges")
+    return perf_metric::edges;
+  if (name == "instructions")
+    return perf_metric::instructions;
+  return std::nullopt;
+}
+
+const char *perf_metric_unit(perf_metric metric)
+{
+  switch (metric)
+  {
+  case perf_metric::time:
+    return "ms";
+  case perf_metric::edges:
+    return "edges";
+  case perf_metric::instructions:
+    return "instructions";
+  default:
+    return "";
+  }
+}
+
+static uint64_t read_clock() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return (uint64_t) std::chrono::steady_clock::now()
+    .time_since_epoch()
+    .count();
+#endif
+}
+
+static std::atomic<double> clock_ticks_per_ms = 0.0;
+
+#if defined(__linux__)
+static int open_instruction_counter() noexcept
+{
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.type           = PERF_TYPE_HARDWARE;
+  attr.size           = sizeof(attr);
+  attr.config         = PERF_COUNT_HW_INSTRUCTIONS;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv     = 1;
+  // this thread only, on any cpu
+  return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+static uint64_t read_instructions() noexcept
+{
+#if defined(__linux__)
+  thread_local int counter = open_instruction_counter();
+  uint64_t count           = 0;
+  if (counter < 0 || read(counter, &count, sizeof(count)) != sizeof(count))
+    return 0;
+  return count;
+#else
+  return 0;
+#endif
+}
+
+void perf_init()
+{
+  if (get_perf_metric() == perf_metric::instructions &&
+      read_instructions() == 0)
+  {
+    {
+      std::lock_guard<std::mutex> lock(get_stream_mutex());
+      std::cerr << "Could not count instructions, measuring time instead\n";
+    }
+    set_perf_metric(perf_metric::time);
+  }
+  if (get_perf_metric() == perf_metric::time && clock_ticks_per_ms == 0.0)
+  {
+    auto start_time        = std::chrono::steady_clock::now();
+    const uint64_t started = read_clock();
+    std::this_thread::sleep_for(
+      std::chrono::milliseconds(PERF_CALIBRATION_MS));
+    const uint64_t ticks = read_clock() - started;
+    std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start_time;
+    clock_ticks_per_ms = (double) ticks / elapsed.count();
+  }
+}
+
+static std::unique_ptr<std::atomic<uint64_t>[]> slowest;
+
+void perf_reset(size_t num_targets)
+{
+  slowest = std::make_unique<std::atomic<uint64_t>[]>(num_targets);
+  for (size_t i = 0; i < num_targets; i++)
+  {
+    slowest[i].store(0);
+  }
+}
+
+uint64_t perf_read(perf_metric metric) noexcept
+{
+  switch (metric)
+  {
+  case perf_metric::time:
+    return read_clock();
+  case perf_metric::edges:
+    return coverage_edge_hits();
+  case perf_metric::instructions:
+    return read_instructions();
+  default:
+    return 0;
+  }
+}
+
+std::optional<uint64_t> perf_measure(uint64_t started,
+                                     uint64_t ended) noexcept
+{
+  // a failed read of the counter would wrap to a huge cost
+  if (started == 0 || ended == 0 || ended < started)
+    return std::nullopt;
+  return ended - started;
+}
+
+double perf_cost(perf_metric metric, uint64_t cost) noexcept
+{
+  if (metric == perf_metric::time && clock_ticks_per_ms > 0.0)
+    return (double) cost / clock_ticks_per_ms;
+  return (double) cost;
+}
+
+bool perf_update(size_t target, uint64_t cost) noexcept
+{
+  std::atomic<uint64_t> &max = slowest[target];
+  uint64_t current           = max.load(std::memory_order_relaxed);
+  while ((double) cost > (double) current * PERF_CORPUS_GAIN)
+  {
+    if (max.compare_exchange_weak(current, cost))
+      return true;
+  }
+  return false;
+}
+
+uint64_t perf_slowest(size_t target) noexcept
+{
+  return slowest[target].load(std::memory_order_relaxed);
+}
+
+bool perf_is_slow(perf_metric metric, uint64_t cost) noexcept
+{
+  const double threshold = get_slow_input_threshold();
+  return threshold > 0.0 && perf_cost(metric, cost) >= threshold;
+}
+
+void record_slow_input(size_t target, uint64_t cost,
+                       const random_engine &state, const uint8_t *data,
+                       size_t size)
+{
+  const perf_metric metric = get_perf_metric();
+  if (!perf_is_slow(metric, cost))
+    return;
+
+  const double value = perf_cost(metric, cost);
+
+  std::ostringstream cost_text;
+  cost_text << std::fixed;
+  cost_text << std::setprecision(metric == perf_metric::time ? 1 : 0);
+  cost_text << value << " " << perf_metric_unit(metric);
+  reproducer repro{get_fuzzs()[target].first, state,
+                   std::vector<uint8_t>(data, data + size), cost_text.str()};
+  // a slow input found again keeps the file of the first time
+  std::error_code ec;
+  if (std::filesystem::exists(reproducer_path(repro, "slow"), ec))
+    return;
+  std::filesystem::path path = save_reproducer(repro, "slow");
+  std::lock_guard<std::mutex> lock(get_stream_mutex());
+  std::cerr << "Slow input on \"" << repro.target << "\": " << repro.cost
+            << ", saved " << path.string() << "\n";
+}
+
+} // namespace valfuzz
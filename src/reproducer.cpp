@@ -0,0 +1,215 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <valfuzz/corpus.hpp>
+#include <valfuzz/data_provider.hpp>
+#include <valfuzz/reproducer.hpp>
+#include <valfuzz/test.hpp>
+
+namespace valfuzz
+{
+
+#define REPRODUCER_HEADER "valfuzz reproducer 1"
+
+std::filesystem::path &get_crash_dir()
+{
+  static std::filesystem::path crash_dir = ".";
+  return crash_dir;
+}
+
+std::optional<std::filesystem::path> &get_replay_file()
+{
+  static std::optional<std::filesystem::path> replay_file = std::nullopt;
+  return replay_file;
+}
+
+void set_crash_dir(const std::filesystem::path &dir)
+{
+  auto &crash_dir = get_crash_dir();
+  crash_dir       = dir;
+}
+
+void set_replay_file(const std::filesystem::path &file)
+{
+  auto &replay_file = get_replay_file();
+  replay_file       = file;
+}
+
+bool write_reproducer(const std::filesystem::path &path,
+                      const reproducer &repro)
+{
+  uint64_t state[4];
+  repro.engine.get_state(state);
+  std::ostringstream header;
+  header << REPRODUCER_HEADER << "\n";
+  header << "target: " << repro.target << "\n";
+  header << "engine:" << std::hex;
+  for (uint64_t word : state)
+  {
+    header << " " << word;
+  }
+  header << std::dec << "\n";
+  if (!repro.cost.empty())
+    header << "cost: " << repro.cost << "\n";
+  header << "size: " << repro.data.size() << "\n\n";
+
+  std::string content = header.str();
+  content.append(repro.data.begin(), repro.data.end());
+  return write_file_atomically(
+    path, reinterpret_cast<const uint8_t *>(content.data()), content.size());
+}
+
+std::optional<reproducer> read_reproducer(const std::filesystem::path &path)
+{
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+    return std::nullopt;
+
+  reproducer repro;
+  std::string line;
+  if (!std::getline(file, line) || line != REPRODUCER_HEADER)
+    return std::nullopt;
+  if (!std::getline(file, line) || line.rfind("target: ", 0) != 0)
+    return std::nullopt;
+  repro.target = line.substr(8);
+
+  if (!std::getline(file, line) || line.rfind("engine:", 0) != 0)
+    return std::nullopt;
+  std::istringstream engine(line.substr(7));
+  uint64_t state[4];
+  for (uint64_t &word : state)
+  {
+    if (!(engine >> std::hex >> word))
+      return std::nullopt;
+  }
+  repro.engine.set_state(state);
+
+  if (!std::getline(file, line))
+    return std::nullopt;
+  if (line.rfind("cost: ", 0) == 0)
+  {
+    repro.cost = line.substr(6);
+    if (!std::getline(file, line))
+      return std::nullopt;
+  }
+  if (line.rfind("size: ", 0) != 0)
+    return std::nullopt;
+  size_t size;
+  try
+  {
+    size = std::stoul(line.substr(6));
+  }
+  catch (const std::exception &)
+  {
+    return std::nullopt;
+  }
+  // the fuzz loop never runs a bigger input
+  if (size > MAX_FUZZ_INPUT_SIZE)
+    return std::nullopt;
+  if (!std::getline(file, line) || !line.empty())
+    return std::nullopt;
+
+  repro.data.resize(size);
+  file.read(reinterpret_cast<char *>(repro.data.data()),
+            (std::streamsize) size);
+  if ((size_t) file.gcount() != size)
+    return std::nullopt;
+  return repro;
+}
+
+std::filesystem::path reproducer_path(const reproducer &repro,
+                                      const std::string &prefix)
+{
+  std::vector<uint8_t> key(repro.target.begin(), repro.target.end());
+  key.insert(key.end(), repro.data.begin(), repro.data.end());
+  return get_crash_dir() /
+         (prefix + "-" + input_file_name(key.data(), key.size()));
+}
+
+std::filesystem::path save_reproducer(const reproducer &repro,
+                                      const std::string &prefix)
+{
+  std::filesystem::path path = reproducer_path(repro, prefix);
+
+  std::error_code ec;
+  std::filesystem::create_directories(get_crash_dir(), ec);
+  if (!write_reproducer(path, repro))
+  {
+    std::lock_guard<std::mutex> lock(get_stream_mutex());
+    std::cerr << "Could not write reproducer " << path << "\n";
+  }
+  return path;
+}
+
+bool record_failure(size_t target, uint64_t signature,
+                    const random_engine &state, const uint8_t *data,
+                    size_t size)
+{
+  if (!claim_failure(signature))
+    return false;
+
+  reproducer repro{get_fuzzs()[target].first, state,
+                   std::vector<uint8_t>(data, data + size)};
+  std::filesystem::path path = save_reproducer(repro);
+  std::lock_guard<std::mutex> lock(get_stream_mutex());
+  std::cerr << "Saved reproducer " << path.string() << "\n";
+  return true;
+}
+
+std::optional<reproducer> &get_thread_failing_input()
+{
+  thread_local std::optional<reproducer> failing_input = std::nullopt;
+  return failing_input;
+}
+
+void set_failing_input(const random_engine &state, const uint8_t *data,
+                       size_t size)
+{
+  get_thread_failing_input() =
+    reproducer{"", state, std::vector<uint8_t>(data, data + size)};
+}
+
+void run_reproducer(const reproducer &repro)
+{
+  const auto &fuzzs = get_fuzzs();
+  auto fuzz         = std::find_if(fuzzs.begin(), fuzzs.end(),
+                                   [&repro](const fuzz_pair &f)
+                                   { return f.first == repro.target; });
+  if (fuzz == fuzzs.end())
+  {
+    std::lock_guard<std::mutex> lock(get_stream_mutex());
+    std::cerr << "Fuzz test \"" << repro.target << "\" not found\n";
+    std::exit(1);
+  }
+
+  get_random_engine() = repro.engine;
+  data_provider provider(repro.data.data(), repro.data.size());
+  fuzz->second(fuzz->first, provider);
+}
+
+void replay_fuzz(const std::filesystem::path &path)
+{
+  auto repro = read_reproducer(path);
+  if (!repro.has_value())
+  {
+    std::lock_guard<std::mutex> lock(get_stream_mutex());
+    std::cerr << "Could not read reproducer " << path << "\n";
+    std::exit(1);
+  }
+  {
+    std::lock_guard<std::mutex> lock(get_stream_mutex());
+    std::cout << "Replaying " << path << " on \"" << repro->target << "\" ("
+              << repro->data.size() << " bytes";
+    if (!repro->cost.empty())
+      std::cout << ", took " << repro->cost;
+    std::cout << ")\n";
+  }
+  run_reproducer(repro.value());
+}
+
+} // namespace valfuzz
@@ -0,0 +1,35 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <valfuzz/scheduler.hpp>
+
+namespace valfuzz
+{
+
+size_t scheduler::next(random_engine &engine) const noexcept
+{
+  // 53 random bits mapped to [0, total_energy)
+  double pick = (double) (engine() >> 11) * 0x1.0p-53 * total_energy;
+  for (size_t i = 0; i + 1 < energies.size(); i++)
+  {
+    if (pick < energies[i])
+      return i;
+    pick -= energies[i];
+  }
+  return energies.size() - 1;
+}
+
+void scheduler::update(size_t target, size_t finds) noexcept
+{
+  double &energy = energies[target];
+  double before  = energy;
+  if (finds > 0)
+    energy = std::min(energy * 2, SCHEDULER_MAX_ENERGY);
+  else
+    energy = std::max(energy * SCHEDULER_DECAY, SCHEDULER_MIN_ENERGY);
+  total_energy += energy - before;
+}
+
+} // namespace valfuzz
@@ -0,0 +1,345 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <valfuzz/corpus.hpp>
+#include <valfuzz/shard.hpp>
+#include <valfuzz/test.hpp>
+
+namespace valfuzz
+{
+
+std::atomic<long unsigned int> &get_shard_index()
+{
+#if __cplusplus >= 202002L // C++20
+  constinit
+#endif
+    static std::atomic<long unsigned int>
+      shard_index = 0;
+  return shard_index;
+}
+
+std::atomic<long unsigned int> &get_shard_count()
+{
+#if __cplusplus >= 202002L // C++20
+  constinit
+#endif
+    static std::atomic<long unsigned int>
+      shard_count = 1;
+  return shard_count;
+}
+
+std::optional<std::filesystem::path> &get_timings_file()
+{
+  static std::optional<std::filesystem::path> timings_file = std::nullopt;
+  return timings_file;
+}
+
+std::optional<std::filesystem::path> &get_timings_out_file()
+{
+  static std::optional<std::filesystem::path> timings_out_file = std::nullopt;
+  return timings_out_file;
+}
+
+void set_shard_index(long unsigned int shard_index)
+{
+  auto &shard_index_ref = get_shard_index();
+  shard_index_ref       = shard_index;
+}
+
+void set_shard_count(long unsigned int shard_count)
+{
+  auto &shard_count_ref = get_shard_count();
+  shard_count_ref       = shard_count;
+}
+
+void set_timings_file(const std::filesystem::path &timings_file)
+{
+  auto &timings_file_ref = get_timings_file();
+  timings_file_ref       = timings_file;
+}
+
+void set_timings_out_file(const std::filesystem::path &timings_out_file)
+{
+  auto &timings_out_file_ref = get_timings_out_file();
+  timings_out_file_ref       = timings_out_file;
+}
+
+/* Tests run in this run */
+static test_timings &get_recorded_timings()
+{
+  static test_timings recorded_timings = {};
+  return recorded_timings;
+}
+
+static std::mutex &get_timings_mutex()
+{
+#if __cplusplus >= 202002L // C++20
+  constinit
+#endif
+    static std::mutex timings_mutex;
+  return timings_mutex;
+}
+
+/* The timings file as it was before this run, read once */
+static const test_timings &get_loaded_timings()
+{
+  static const test_timings loaded_timings =
+    get_timings_file().has_value()
+      ? read_test_timings(get_timings_file().value())
+      : test_timings{};
+  return loaded_timings;
+}
+
+test_timings read_test_timings(const std::filesystem::path &path)
+{
+  test_timings timings;
+  std::ifstream file(path);
+  std::string line;
+  bool has_failures = true;
+  while (std::getline(file, line))
+  {
+    // concatenated files repeat the header
+    if (line == TIMINGS_HEADER || line == TIMINGS_HEADER_V1)
+    {
+      has_failures = line == TIMINGS_HEADER;
+      continue;
+    }
+    std::istringstream in(line);
+    test_record record;
+    std::string since_failure;
+    if (!(in >> record.seconds) || record.seconds < 0)
+      continue;
+    if (has_failures)
+    {
+      if (!(in >> since_failure))
+        continue;
+      if (since_failure != "-")
+      {
+        try
+        {
+          record.since_failure = std::stoul(since_failure);
+        }
+        catch (const std::exception &)
+        {
+          continue;
+        }
+      }
+    }
+    if (in.get() != ' ')
+      continue;
+    std::string name;
+    std::getline(in, name);
+    timings[name] = record;
+  }
+  return timings;
+}
+
+bool write_test_timings(const std::filesystem::path &path,
+                        const test_timings &timings)
+{
+  // sorted, so the file does not change when the times do not
+  std::vector<std::pair<std::string, test_record>> sorted(timings.begin(),
+                                                          timings.end());
+  std::sort(sorted.begin(), sorted.end(),
+            [](const auto &a, const auto &b) { return a.first < b.first; });
+  std::ostringstream out;
+  out << std::setprecision(std::numeric_limits<double>::max_digits10);
+  out << TIMINGS_HEADER << "\n";
+  for (const auto &[name, record] : sorted)
+  {
+    out << record.seconds << " ";
+    if (record.since_failure == TIMINGS_NEVER_FAILED)
+      out << "-";
+    else
+      out << record.since_failure;
+    out << " " << name << "\n";
+  }
+
+  std::string content = out.str();
+  return write_file_atomically(
+    path, reinterpret_cast<const uint8_t *>(content.data()), content.size());
+}
+
+/* The duration of each test, the mean of the others if unknown, or 1
+ * if none is known */
+static std::vector<double> test_weights(const std::vector<std::string> &names,
+                                        const test_timings &timings)
+{
+  double known_total = 0;
+  size_t known       = 0;
+  for (const auto &name : names)
+  {
+    auto it = timings.find(name);
+    if (it != timings.end())
+    {
+      known_total += it->second.seconds;
+      known++;
+    }
+  }
+  const double unknown = known == 0 ? 1.0 : known_total / (double) known;
+  std::vector<double> weights(names.size());
+  for (size_t i = 0; i < names.size(); i++)
+  {
+    auto it    = timings.find(names[i]);
+    weights[i] = it == timings.end() ? unknown : it->second.seconds;
+  }
+  return weights;
+}
+
+std::vector<size_t> assign_shards(const std::vector<std::string> &names,
+                                  size_t shard_count,
+                                  const test_timings &timings)
+{
+  std::vector<size_t> shards(names.size(), 0);
+  if (shard_count <= 1)
+    return shards;
+  const std::vector<double> weights = test_weights(names, timings);
+
+  // longest processing time first, ties broken by name and then by
+  // registration order so every process agrees
+  std::vector<size_t> order(names.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](size_t a, size_t b)
+                   {
+                     if (weights[a] != weights[b])
+                       return weights[a] > weights[b];
+                     return names[a] < names[b];
+                   });
+  std::vector<double> loads(shard_count, 0);
+  for (size_t i : order)
+  {
+    const size_t shard = (size_t) (std::min_element(loads.begin(), loads.end()) -
+                                   loads.begin());
+    shards[i]          = shard;
+    loads[shard] += weights[i];
+  }
+  return shards;
+}
+
+/* The names of the registered tests, with the tests mutex held */
+static std::vector<std::string> test_names(const std::deque<test_pair> &tests)
+{
+  std::vector<std::string> names;
+  for (const auto &test : tests)
+  {
+    names.push_back(test.first);
+  }
+  return names;
+}
+
+void shard_tests()
+{
+  const size_t shard_count = get_shard_count();
+  if (shard_count <= 1)
+    return;
+  auto &tests = get_tests();
+  std::lock_guard<std::mutex> lock(get_tests_mutex());
+  const std::vector<size_t> shards =
+    assign_shards(test_names(tests), shard_count, get_loaded_timings());
+  std::deque<test_pair> kept;
+  for (size_t i = 0; i < tests.size(); i++)
+  {
+    if (shards[i] == get_shard_index())
+      kept.push_back(std::move(tests[i]));
+  }
+  tests = std::move(kept);
+}
+
+std::vector<size_t> history_order(const std::vector<std::string> &names,
+                                  const test_timings &timings)
+{
+  const std::vector<double> weights = test_weights(names, timings);
+  std::vector<long unsigned int> since_failure(names.size(),
+                                               TIMINGS_NEVER_FAILED);
+  for (size_t i = 0; i < names.size(); i++)
+  {
+    auto it = timings.find(names[i]);
+    if (it != timings.end() && it->second.since_failure < TIMINGS_RECENT_RUNS)
+      since_failure[i] = it->second.since_failure;
+  }
+
+  std::vector<size_t> order(names.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](size_t a, size_t b)
+                   {
+                     if (since_failure[a] != since_failure[b])
+                       return since_failure[a] < since_failure[b];
+                     return weights[a] > weights[b];
+                   });
+  return order;
+}
+
+void order_tests()
+{
+  if (!get_timings_file().has_value())
+    return;
+  auto &tests = get_tests();
+  std::lock_guard<std::mutex> lock(get_tests_mutex());
+  const std::vector<size_t> order =
+    history_order(test_names(tests), get_loaded_timings());
+  std::deque<test_pair> ordered;
+  for (size_t i : order)
+  {
+    ordered.push_back(std::move(tests[i]));
+  }
+  tests = std::move(ordered);
+}
+
+std::optional<std::filesystem::path> timings_output_file()
+{
+  if (get_timings_out_file().has_value())
+    return get_timings_out_file();
+  // the shards read the partition from the input file, so a shard that
+  // rewrote it would move tests under the feet of the others
+  if (get_shard_count() > 1)
+    return std::nullopt;
+  return get_timings_file();
+}
+
+void record_test_run(const std::string &name, double seconds, bool failed)
+{
+  if (!timings_output_file().has_value())
+    return;
+  test_record record;
+  record.seconds = seconds;
+  if (failed)
+  {
+    record.since_failure = 0;
+  }
+  else
+  {
+    auto it = get_loaded_timings().find(name);
+    if (it != get_loaded_timings().end() &&
+        it->second.since_failure != TIMINGS_NEVER_FAILED)
+      record.since_failure = it->second.since_failure + 1;
+  }
+  std::lock_guard<std::mutex> lock(get_timings_mutex());
+  get_recorded_timings()[name] = record;
+}
+
+void save_test_timings()
+{
+  const std::optional<std::filesystem::path> path = timings_output_file();
+  if (!path.has_value())
+    return;
+  // only the tests that ran, so that the file of a shard does not hold
+  // stale lines for the tests of the others
+  std::lock_guard<std::mutex> lock(get_timings_mutex());
+  if (!write_test_timings(path.value(), get_recorded_timings()))
+  {
+    std::lock_guard<std::mutex> stream_lock(get_stream_mutex());
+    std::cerr << "Could not save test timings to " << path.value() << "\n";
+  }
+}
+
+} // namespace valfuzz
@@ -0,0 +1,320 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <condition_variable>
+#include <iomanip>
+#include <sstream>
+#include <valfuzz/checkpoint.hpp>
+#include <valfuzz/corpus.hpp>
+#include <valfuzz/coverage.hpp>
+#include <valfuzz/fuzz.hpp>
+#include <valfuzz/stats.hpp>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/resource.h>
+#endif
+
+namespace valfuzz
+{
+
+fuzz_stats::~fuzz_stats()
+{
+  release();
+}
+
+void fuzz_stats::release() noexcept
+{
+  if (counters == nullptr)
+    return;
+#if defined(__linux__)
+  if (shared)
+    munmap(counters, size);
+  else
+#endif
+    delete[] counters;
+  counters = nullptr;
+}
+
+void fuzz_stats::reset(size_t workers, size_t targets)
+{
+  release();
+  num_workers = workers;
+  num_targets = targets;
+  // a row takes whole cache lines
+  stride = (targets + 7) & ~(size_t) 7;
+  size   = std::max<size_t>(workers * stride, 1) * sizeof(uint64_t);
+  shared = false;
+#if defined(__linux__)
+  void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (memory != MAP_FAILED)
+  {
+    // anonymous mappings are zeroed
+    counters = static_cast<std::atomic<uint64_t> *>(memory);
+    shared   = true;
+    return;
+  }
+#endif
+  counters = new std::atomic<uint64_t>[size / sizeof(uint64_t)]();
+}
+
+fuzz_stats &get_fuzz_stats()
+{
+  static fuzz_stats stats;
+  return stats;
+}
+
+std::atomic<long unsigned int> &get_stats_interval()
+{
+#if __cplusplus >= 202002L // C++20
+  constinit
+#endif
+    static std::atomic<long unsigned int>
+      stats_interval = STATS_DEFAULT_INTERVAL;
+  return stats_interval;
+}
+
+std::optional<std::filesystem::path> &get_stats_file()
+{
+  static std::optional<std::filesystem::path> stats_file = std::nullopt;
+  return stats_file;
+}
+
+void set_stats_interval(long unsigned int seconds)
+{
+  auto &stats_interval = get_stats_interval();
+  stats_interval       = seconds;
+}
+
+void set_stats_file(const std::filesystem::path &file)
+{
+  auto &stats_file = get_stats_file();
+  stats_file       = file;
+}
+
+uint64_t get_peak_rss_kb()
+{
+#if defined(__linux__)
+  struct rusage self, children;
+  if (getrusage(RUSAGE_SELF, &self) != 0 ||
+      getrusage(RUSAGE_CHILDREN, &children) != 0)
+    return 0;
+  // isolated workers are children, ru_maxrss is in KiB
+  return (uint64_t) std::max(self.ru_maxrss, children.ru_maxrss);
+#else
+  return 0;
+#endif
+}
+
+stats_snapshot take_stats_snapshot(const fuzz_stats &stats, double seconds)
+{
+  stats_snapshot snapshot;
+  snapshot.seconds = seconds;
+  snapshot.target_execs.resize(stats.get_num_targets(), 0);
+  snapshot.worker_execs.resize(stats.get_num_workers(), 0);
+  for (size_t w = 0; w < stats.get_num_workers(); w++)
+  {
+    for (size_t t = 0; t < stats.get_num_targets(); t++)
+    {
+      uint64_t execs = stats.get(w, t);
+      snapshot.target_execs[t] += execs;
+      snapshot.worker_execs[w] += execs;
+      snapshot.execs += execs;
+    }
+  }
+  snapshot.edges       = get_coverage_edges();
+  snapshot.corpus      = get_corpus_size();
+  snapshot.peak_rss_kb = get_peak_rss_kb();
+  return snapshot;
+}
+
+static double rate(uint64_t now, uint64_t before, double seconds)
+{
+  if (seconds <= 0 || now < before)
+    return 0;
+  return (double) (now - before) / seconds;
+}
+
+/* Counters missing in a snapshot count as zero */
+static uint64_t at(const std::vector<uint64_t> &execs, size_t i)
+{
+  return i < execs.size() ? execs[i] : 0;
+}
+
+void print_stats(std::ostream &out, const stats_snapshot &now,
+                 const stats_snapshot &before, bool verbose)
+{
+  const double seconds = now.seconds - before.seconds;
+  const auto &fuzzs    = get_fuzzs();
+  out << std::fixed << std::setprecision(0);
+  out << "[" << now.seconds << "s] execs: " << now.execs << " ("
+      << rate(now.execs, before.execs, seconds) << "/s)";
+  if (now.edges > 0)
+  {
+    out << std::setprecision(1);
+    out << ", corpus: " << now.corpus << ", edges: " << now.edges << " (+"
+        << rate(now.edges, before.edges, seconds) << "/s)";
+  }
+  out << ", peak rss: " << now.peak_rss_kb / 1024 << " MiB\n";
+  out << std::setprecision(0);
+  if (!verbose)
+    return;
+  for (size_t t = 0; t < now.target_execs.size() && t < fuzzs.size(); t++)
+  {
+    out << "  target \"" << fuzzs[t].first << "\": "
+        << rate(now.target_execs[t], at(before.target_execs, t), seconds)
+        << "/s\n";
+  }
+  for (size_t w = 0; w < now.worker_execs.size(); w++)
+  {
+    out << "  worker " << w << ": "
+        << rate(now.worker_execs[w], at(before.worker_execs, w), seconds)
+        << "/s\n";
+  }
+}
+
+static void write_json_string(std::ostream &out, const std::string &str)
+{
+  out << '"';
+  for (char c : str)
+  {
+    if (c == '"' || c == '\\')
+      out << '\\' << c;
+    else if ((unsigned char) c < 0x20)
+      out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+          << (int) c << std::dec << std::setfill(' ');
+    else
+      out << c;
+  }
+  out << '"';
+}
+
+void write_stats(std::ostream &out, const stats_snapshot &now,
+                 const stats_snapshot &before)
+{
+  const double seconds = now.seconds - before.seconds;
+  const auto &fuzzs    = get_fuzzs();
+  out << std::fixed << std::setprecision(3);
+  out << "{\n";
+  out << "  \"seconds\": " << now.seconds << ",\n";
+  out << "  \"execs\": " << now.execs << ",\n";
+  out << "  \"execs_per_sec\": " << rate(now.execs, before.execs, seconds)
+      << ",\n";
+  out << "  \"corpus\": " << now.corpus << ",\n";
+  out << "  \"edges\": " << now.edges << ",\n";
+  out << "  \"new_edges_per_sec\": "
+      << rate(now.edges, before.edges, seconds) << ",\n";
+  out << "  \"peak_rss_kb\": " << now.peak_rss_kb << ",\n";
+  out << "  \"targets\": [";
+  for (size_t t = 0; t < now.target_execs.size(); t++)
+  {
+    out << (t == 0 ? "\n" : ",\n") << "    {\"name\": ";
+    write_json_string(out, t < fuzzs.size() ? fuzzs[t].first : "");
+    out << ", \"execs\": " << now.target_execs[t] << ", \"execs_per_sec\": "
+        << rate(now.target_execs[t], at(before.target_execs, t), seconds)
+        << "}";
+  }
+  out << "\n  ],\n";
+  out << "  \"workers\": [";
+  for (size_t w = 0; w < now.worker_execs.size(); w++)
+  {
+    out << (w == 0 ? "\n" : ",\n") << "    {\"id\": " << w
+        << ", \"execs\": " << now.worker_execs[w] << ", \"execs_per_sec\": "
+        << rate(now.worker_execs[w], at(before.worker_execs, w), seconds)
+        << "}";
+  }
+  out << "\n  ]\n";
+  out << "}\n";
+}
+
+stats_reporter::stats_reporter() : start(std::chrono::steady_clock::now())
+{
+  last = take_stats_snapshot(get_fuzz_stats(), 0);
+}
+
+double stats_reporter::elapsed() const
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+    .count();
+}
+
+void stats_reporter::poll()
+{
+  if (elapsed() - last.seconds >= (double) get_stats_interval().load())
+    report();
+}
+
+void stats_reporter::report()
+{
+  stats_snapshot now = take_stats_snapshot(get_fuzz_stats(), elapsed());
+  {
+    std::ostringstream line;
+    print_stats(line, now, last, get_verbose());
+    std::lock_guard<std::mutex> lock(get_stream_mutex());
+    std::cout << line.str() << std::flush;
+  }
+  if (get_stats_file().has_value())
+  {
+    std::ostringstream json;
+    write_stats(json, now, last);
+    std::string content = json.str();
+    if (!write_file_atomically(get_stats_file().value(),
+                               reinterpret_cast<const uint8_t *>(
+                                 content.data()),
+                               content.size()))
+    {
+      std::lock_guard<std::mutex> lock(get_stream_mutex());
+      std::cerr << "Could not write stats file "
+                << get_stats_file().value() << "\n";
+    }
+  }
+  last = std::move(now);
+}
+
+static std::mutex stats_thread_mutex;
+static std::condition_variable stats_thread_cv;
+static bool stats_thread_stop = false;
+static std::thread stats_thread;
+
+void start_stats_thread()
+{
+  {
+    std::lock_guard<std::mutex> lock(stats_thread_mutex);
+    stats_thread_stop = false;
+  }
+  stats_thread = std::thread(
+    []()
+    {
+      stats_reporter reporter;
+      std::unique_lock<std::mutex> lock(stats_thread_mutex);
+      while (!stats_thread_cv.wait_for(
+        lock, std::chrono::seconds(get_stats_interval().load()),
+        []() { return stats_thread_stop; }))
+      {
+        lock.unlock();
+        reporter.report();
+        checkpoint_poll();
+        lock.lock();
+      }
+      lock.unlock();
+      reporter.report();
+    });
+}
+
+void stop_stats_thread()
+{
+  if (!stats_thread.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(stats_thread_mutex);
+    stats_thread_stop = true;
+  }
+  stats_thread_cv.notify_all();
+  stats_thread.join();
+}
+
+} // namespace valfuzz
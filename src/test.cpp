@@ -3,6 +3,8 @@
 // Mail:    giovanni.santini@proton.me
 // Github:  @San7o
 
+#include <chrono>
+#include <valfuzz/shard.hpp>
 #include <valfuzz/test.hpp>
 
 namespace valfuzz
@@ -30,6 +32,14 @@ std::atomic<bool> &get_has_failed_once()
   return has_failed_once;
 }
 
+/* Set when an assertion fails on this thread, the fuzz loop uses it
+ * to know which input failed */
+bool &get_thread_has_failed()
+{
+  thread_local bool thread_has_failed = false;
+  return thread_has_failed;
+}
+
 std::function<void()> &get_function_execute_before()
 {
   static std::function<void()> function_execute_before = []() {};
@@ -58,6 +68,8 @@ void set_has_failed_once(bool has_failed_once)
 {
   auto &has_failed_once_ref = get_has_failed_once();
   has_failed_once_ref       = has_failed_once;
+  if (has_failed_once)
+    get_thread_has_failed() = true;
 }
 
 void add_test(const std::string &name, test_function test)
@@ -107,18 +119,27 @@ void run_one_test(const std::string &name)
   }
 }
 
+static void run_test(const valfuzz::test_pair &test)
+{
+  // the output of a test is printed together when it ends
+  log_begin_group();
+  if (get_verbose())
+    log_line(std::cout) << "Running test: \"" << test.first << "\"\n";
+  get_thread_has_failed() = false;
+  auto start              = std::chrono::steady_clock::now();
+  test.second(test.first);
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+  record_test_run(test.first, elapsed.count(), get_thread_has_failed());
+  log_end_group();
+}
+
 void _run_tests()
 {
   auto test = std::optional<valfuzz::test_pair>{};
   while ((test = pop_test_or_null()).has_value())
   {
-    // run task
-    if (get_verbose())
-    {
-      std::lock_guard<std::mutex> lock(get_stream_mutex());
-      std::cout << "Running test: \"" << test.value().first << "\"\n";
-    }
-    test.value().second(test.value().first);
+    run_test(test.value());
   }
 }
 
@@ -126,22 +147,22 @@ void run_tests()
 {
   if (get_is_threaded())
   {
+    // one task per test, idle workers steal from the busy ones
     auto &thread_pool = get_thread_pool();
-    // spawn threads
-    for (long unsigned int i = 0;
-         i < get_max_num_threads() && i < get_num_tests(); i++)
-    {
-      thread_pool.push_back(std::thread(_run_tests));
-    }
-    for (auto &thread : get_thread_pool())
+    auto test         = std::optional<valfuzz::test_pair>{};
+    while ((test = pop_test_or_null()).has_value())
     {
-      thread.join();
+      thread_pool.submit([test = std::move(test.value())]()
+                         { run_test(test); });
     }
+    thread_pool.wait();
   }
   else
   {
     _run_tests();
   }
+  log_drain();
+  report_failure_counts();
 }
 
 } // namespace valfuzz
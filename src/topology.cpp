@@ -0,0 +1,222 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include <valfuzz/topology.hpp>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace valfuzz
+{
+
+size_t cpu_topology::cache_size(int level) const noexcept
+{
+  for (const cache_info &cache : caches)
+  {
+    if (cache.level == level && cache.type != "Instruction")
+      return cache.size;
+  }
+  return 0;
+}
+
+size_t cpu_topology::last_level_cache_size() const noexcept
+{
+  int last = 0;
+  for (const cache_info &cache : caches)
+  {
+    if (cache.type != "Instruction")
+      last = std::max(last, cache.level);
+  }
+  return cache_size(last);
+}
+
+size_t cpu_topology::cache_line_size() const noexcept
+{
+  for (const cache_info &cache : caches)
+  {
+    if (cache.line_size > 0)
+      return cache.line_size;
+  }
+  return TOPOLOGY_DEFAULT_LINE_SIZE;
+}
+
+std::vector<size_t> parse_cpu_list(const std::string &list)
+{
+  std::vector<size_t> cpus;
+  std::istringstream in(list);
+  std::string range;
+  while (std::getline(in, range, ','))
+  {
+    if (range.empty() || range == "\n")
+      continue;
+    try
+    {
+      size_t dash        = range.find('-');
+      const size_t first = std::stoul(range.substr(0, dash));
+      const size_t last =
+        dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+      for (size_t cpu = first; cpu <= last; cpu++)
+      {
+        cpus.push_back(cpu);
+      }
+    }
+    catch (const std::exception &)
+    {
+      return {};
+    }
+  }
+  return cpus;
+}
+
+size_t parse_cache_size(const std::string &size)
+{
+  try
+  {
+    size_t end;
+    size_t bytes = std::stoul(size, &end);
+    if (end < size.size())
+    {
+      switch (size[end])
+      {
+      case 'K':
+        bytes *= 1024;
+        break;
+      case 'M':
+        bytes *= 1024 * 1024;
+        break;
+      case 'G':
+        bytes *= 1024 * 1024 * 1024;
+        break;
+      default:
+        break;
+      }
+    }
+    return bytes;
+  }
+  catch (const std::exception &)
+  {
+    return 0;
+  }
+}
+
+/* First line of a sysfs file, empty if it cannot be read */
+static std::string read_line(const std::filesystem::path &path)
+{
+  std::ifstream file(path);
+  std::string line;
+  std::getline(file, line);
+  return line;
+}
+
+static size_t read_number(const std::filesystem::path &path)
+{
+  try
+  {
+    return std::stoul(read_line(path));
+  }
+  catch (const std::exception &)
+  {
+    return 0;
+  }
+}
+
+cpu_topology read_cpu_topology(const std::filesystem::path &root,
+                               const std::vector<size_t> &cpus)
+{
+  cpu_topology topology;
+  const std::filesystem::path cpu_dir = root / "cpu";
+  std::vector<size_t> online = parse_cpu_list(read_line(cpu_dir / "online"));
+  if (!cpus.empty())
+  {
+    std::vector<size_t> allowed;
+    for (size_t cpu : cpus)
+    {
+      if (online.empty() ||
+          std::find(online.begin(), online.end(), cpu) != online.end())
+        allowed.push_back(cpu);
+    }
+    online = std::move(allowed);
+  }
+  if (online.empty())
+  {
+    topology.logical_cpus =
+      std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    topology.physical_cores = topology.logical_cpus;
+    return topology;
+  }
+
+  std::set<std::pair<size_t, size_t>> cores;  // (package, core)
+  std::set<size_t> packages;
+  for (size_t cpu : online)
+  {
+    const std::filesystem::path topology_dir =
+      cpu_dir / ("cpu" + std::to_string(cpu)) / "topology";
+    const size_t package = read_number(topology_dir / "physical_package_id");
+    // without a core id every cpu is its own core
+    const bool has_core = std::filesystem::exists(topology_dir / "core_id");
+    cores.insert(
+      {package, has_core ? read_number(topology_dir / "core_id") : cpu});
+    packages.insert(package);
+  }
+  topology.logical_cpus   = online.size();
+  topology.physical_cores = cores.size();
+  topology.packages       = packages.size();
+
+  const std::filesystem::path cache_dir =
+    cpu_dir / ("cpu" + std::to_string(online.front())) / "cache";
+  for (size_t index = 0;; index++)
+  {
+    const std::filesystem::path index_dir =
+      cache_dir / ("index" + std::to_string(index));
+    if (!std::filesystem::exists(index_dir))
+      break;
+    cache_info cache;
+    cache.level     = (int) read_number(index_dir / "level");
+    cache.type      = read_line(index_dir / "type");
+    cache.size      = parse_cache_size(read_line(index_dir / "size"));
+    cache.line_size = read_number(index_dir / "coherency_line_size");
+    cache.shared_by = std::max<size_t>(
+      parse_cpu_list(read_line(index_dir / "shared_cpu_list")).size(), 1);
+    topology.caches.push_back(cache);
+  }
+
+  topology.numa_nodes = std::max<size_t>(
+    parse_cpu_list(read_line(root / "node" / "online")).size(), 1);
+  return topology;
+}
+
+/* The CPUs this process may run on, empty if unknown */
+static std::vector<size_t> affinity_cpus()
+{
+  std::vector<size_t> cpus;
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) != 0)
+    return cpus;
+  for (size_t cpu = 0; cpu < CPU_SETSIZE; cpu++)
+  {
+    if (CPU_ISSET(cpu, &set))
+      cpus.push_back(cpu);
+  }
+#endif
+  return cpus;
+}
+
+const cpu_topology &get_cpu_topology()
+{
+  static const cpu_topology topology =
+    read_cpu_topology(TOPOLOGY_SYSFS_ROOT, affinity_cpus());
+  return topology;
+}
+
+} // namespace valfuzz
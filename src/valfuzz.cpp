@@ -49,13 +49,6 @@ std::optional<std::string> &get_fuzz_one()
   return fuzz_one;
 }
 
-std::atomic<long unsigned int> &get_seed()
-{
-  static std::atomic<long unsigned int> seed =
-    (long unsigned int) std::time(nullptr);
-  return seed;
-}
-
 void set_multithreaded(bool is_threaded)
 {
   auto &is_threaded_ref = get_is_threaded();
@@ -98,12 +91,6 @@ void set_fuzz_one(const std::string &fuzz_one)
   fuzz_one_ref       = fuzz_one;
 }
 
-void set_seed(long unsigned int new_seed)
-{
-  auto &seed = get_seed();
-  seed       = new_seed;
-}
-
 char valfuzz_banner[] = "             _ _____              \n"
                         " __   ____ _| |  ___|   _ ________\n"
                         " \\ \\ / / _` | | |_ | | | |_  /_  /\n"
@@ -125,6 +112,10 @@ void print_header()
   std::cout << "Settings:\n";
   std::cout << " - Multithreaded: " << is_threaded << "\n";
   std::cout << " - Max threads: " << max_num_threads << "\n";
+  const cpu_topology &topology = get_cpu_topology();
+  std::cout << " - CPUs: " << topology.logical_cpus << " logical, "
+            << topology.physical_cores << " physical, "
+            << topology.numa_nodes << " NUMA nodes\n";
   std::cout << " - Run Fuzzs: " << do_fuzzing << "\n";
   std::cout << " - Run Benchmarks: " << do_benchmarks << "\n";
   std::cout << " - Verbose: " << verbose << "\n";
@@ -167,6 +158,197 @@ void parse_args(int argc, char *argv[])
         std::exit(1);
       }
     }
+    else if (std::string(argv[i]) == "--fuzz-time")
+    {
+      if (i + 1 < argc)
+      {
+        set_fuzz_time(std::stoul(argv[i + 1]));
+        i++;
+      }
+      else
+      {
+        std::cerr << "Fuzzing time not provided\n";
+        std::exit(1);
+      }
+    }
+    else if (std::string(argv[i]) == "--fuzz-runs")
+    {
+      if (i + 1 < argc)
+      {
+        set_fuzz_runs(std::stoul(argv[i + 1]));
+        i++;
+      }
+      else
+      {
+        std::cerr << "Number of fuzzing runs not provided\n";
+        std::exit(1);
+      }
+    }
+    else if (std::string(argv[i]) == "--diff-tolerance")
+    {
+      if (i + 1 < argc)
+      {
+        set_diff_tolerance(std::stod(argv[i + 1]));
+        i++;
+      }
+      else
+      {
+        std::cerr << "Tolerance not provided\n";
+        std::exit(1);
+      }
+    }
+    else if (std::string(argv[i]) == "--value-profile")
+    {
+      set_use_value_profile(true);
+    }
+    else if (std::string(argv[i]) == "--perf")
+    {
+      if (i + 1 < argc && parse_perf_metric(argv[i + 1]).has_value())
+      {
+        set_perf_metric(parse_perf_metric(argv[i + 1]).value());
+        i++;
+      }
+      else
+      {
+        std::cerr << "Metric not provided, use time, edges or "
+                     "instructions\n";
+        std::exit(1);
+      }
+    }
+    else if (std::string(argv[i]) == "--slow-input-threshold")
+    {
+      if (i + 1 < argc)
+      {
+        set_slow_input_threshold(std::stod(argv[i + 1]));
+        i++;
+      }
+      else
+      {
+        std::cerr << "Threshold not provided\n";
+        std::exit(1);
+      }
+    }
+    else if (std::string(argv[i]) == "--corpus")
+    {
+      if (i + 1 < argc)
+      {
+        set_corpus_dir(argv[i + 1]);
+        i++;
+      }
+      else
+      {
+        std::cerr << "Corpus directory not provided\n";
+        std::exit(1);
+      }
+    }
+    else if (std::string(argv[i]) == "--isolated")
+    {
+      set_is_isolated(true);
+    }
+    else if (std::string(argv[i]) == "--checkpoint")
+    {
+      if (i + 1 < argc)
+      {
+        set_checkpoint_dir(argv[i + 1]);
+        i++;
+      }
+      else
+      {
+        std::cerr << "Checkpoint directory not provided\n";
+        std::exit(1);
+      }
+    }
+    else if (std::string(argv[i]) == "--checkpoint-interval")
+    {
+      if (i + 1 < argc && std::stoul(argv[i + 1]) > 0)
+      {
+        set_checkpoint_interval(std::stoul(argv[i + 1]));
+        i++;
+      }
+      else
+      {
+        std::cerr << "Checkpoint interval not provided\n";
+        std::exit(1);
+      }
+    }
+    else if (std::string(argv[i]) == "--resume")
+    {
+      if (i + 1 < argc)
+      {
+        set_resume_dir(argv[i + 1]);
+        i++;
+      }
+      else
+      {
+        std::cerr << "Checkpoint directory not provided\n";
+        std::exit(1);
+      }
+    }
+    else if (std::string(argv[i]) == "--stats-interval")
+    {
+      if (i + 1 < argc && std::stoul(argv[i + 1]) > 0)
+      {
+        set_stats_interval(std::stoul(argv[i + 1]));
+        i++;
+      }
+      else
+      {
+        std::cerr << "Stats interval not provided\n";
+        std::exit(1);
+      }
+    }
+    else if (std::string(argv[i]) == "--stats-file")
+    {
+      if (i + 1 < argc)
+      {
+        set_stats_file(argv[i + 1]);
+        i++;
+      }
+      else
+      {
+        std::cerr << "Stats file not provided\n";
+        std::exit(1);
+      }
+    }
+    else if (std::string(argv[i]) == "--crash-dir")
+    {
+      if (i + 1 < argc)
+      {
+        set_crash_dir(argv[i + 1]);
+        i++;
+      }
+      else
+      {
+        std::cerr << "Crash directory not provided\n";
+        std::exit(1);
+      }
+    }
+    else if (std::string(argv[i]) == "--replay")
+    {
+      if (i + 1 < argc)
+      {
+        set_replay_file(argv[i + 1]);
+        i++;
+      }
+      else
+      {
+        std::cerr << "Reproducer file not provided\n";
+        std::exit(1);
+      }
+    }
+    else if (std::string(argv[i]) == "--minimize")
+    {
+      if (i + 1 < argc)
+      {
+        set_minimize_file(argv[i + 1]);
+        i++;
+      }
+      else
+      {
+        std::cerr << "Reproducer file not provided\n";
+        std::exit(1);
+      }
+    }
     else if (std::string(argv[i]) == "--benchmark")
     {
       set_do_benchmarks(true);
@@ -235,6 +417,58 @@ void parse_args(int argc, char *argv[])
         std::exit(1);
       }
     }
+    else if (std::string(argv[i]) == "--shard-index")
+    {
+      if (i + 1 < argc)
+      {
+        set_shard_index(std::stoul(argv[i + 1]));
+        i++;
+      }
+      else
+      {
+        std::cerr << "Shard index not provided\n";
+        std::exit(1);
+      }
+    }
+    else if (std::string(argv[i]) == "--shard-count")
+    {
+      if (i + 1 < argc)
+      {
+        set_shard_count(std::stoul(argv[i + 1]));
+        i++;
+      }
+      else
+      {
+        std::cerr << "Shard count not provided\n";
+        std::exit(1);
+      }
+    }
+    else if (std::string(argv[i]) == "--timings")
+    {
+      if (i + 1 < argc)
+      {
+        set_timings_file(argv[i + 1]);
+        i++;
+      }
+      else
+      {
+        std::cerr << "Timings file not provided\n";
+        std::exit(1);
+      }
+    }
+    else if (std::string(argv[i]) == "--timings-out")
+    {
+      if (i + 1 < argc)
+      {
+        set_timings_out_file(argv[i + 1]);
+        i++;
+      }
+      else
+      {
+        std::cerr << "Timings output file not provided\n";
+        std::exit(1);
+      }
+    }
     else if (std::string(argv[i]) == "--no-multithread")
     {
       set_multithreaded(false);
@@ -276,17 +510,57 @@ void parse_args(int argc, char *argv[])
     else if (std::string(argv[i]) == "--help")
     {
       std::cout << valfuzz_banner << "\n";
-      std::cout << "Usage: valfuzz [options]\n";
+      std::cout << "Usage: valfuzz [options] [seed files or directories]\n";
       std::cout << "Options:\n";
       std::cout << "\n";
       std::cout << " TESTS \n";
       std::cout << "  --test <name>: run a specific test\n";
       std::cout << "  --no-multithread: run tests in a single thread\n";
       std::cout << "  --max-threads <num>: set the maximum number of threads\n";
+      std::cout << "  --shard-index <i>: run only the tests of shard i, "
+                   "from 0\n";
+      std::cout << "  --shard-count <n>: split the tests in n shards\n";
+      std::cout << "  --timings <file>: balance the shards and order the "
+                   "tests with the durations and failures in a file, and "
+                   "update it if not sharded\n";
+      std::cout << "  --timings-out <file>: write the durations and "
+                   "failures of this run to a file\n";
       std::cout << "\n";
       std::cout << " FUZZING \n";
       std::cout << "  --fuzz: run fuzz tests\n";
       std::cout << "  --fuzz-one <name>: run a specific fuzz test\n";
+      std::cout << "  --fuzz-time <seconds>: stop fuzzing after some time\n";
+      std::cout << "  --fuzz-runs <num>: stop fuzzing after some iterations\n";
+      std::cout << "  --diff-tolerance <eps>: relative tolerance of floating "
+                   "point outputs in FUZZ_DIFF\n";
+      std::cout << "  --value-profile: keep inputs that get closer to the "
+                   "operands of comparisons\n";
+      std::cout << "  --perf <metric>: keep the slowest inputs in the corpus, "
+                   "measured in time, edges or instructions\n";
+      std::cout << "  --slow-input-threshold <n>: save inputs slower than n "
+                   "milliseconds, edges or instructions\n";
+      std::cout << "  --corpus <dir>: load seeds from and save new inputs to "
+                   "a directory\n";
+      std::cout << "  <file or dir>...: seed inputs for every fuzz test, like "
+                   "libFuzzer's corpora\n";
+      std::cout << "  --isolated: run each fuzz worker in its own process, "
+                   "restarting it if it crashes\n";
+      std::cout << "  --checkpoint <dir>: save the fuzz campaign to a "
+                   "directory periodically and when interrupted\n";
+      std::cout << "  --checkpoint-interval <seconds>: save a checkpoint "
+                   "every interval, default 60\n";
+      std::cout << "  --resume <dir>: continue the fuzz campaign saved in a "
+                   "checkpoint directory\n";
+      std::cout << "  --stats-interval <seconds>: print fuzzing statistics "
+                   "every interval, default 5\n";
+      std::cout << "  --stats-file <file>: save fuzzing statistics to a JSON "
+                   "file\n";
+      std::cout << "  --crash-dir <dir>: save reproducers of failing inputs "
+                   "to a directory\n";
+      std::cout << "  --replay <file>: run a reproducer once in a single "
+                   "thread\n";
+      std::cout << "  --minimize <file>: shrink the input of a reproducer "
+                   "and save the result in the crash directory\n";
       std::cout << "\n";
       std::cout << " BENCHMARK \n";
       std::cout << "  --benchmark: run benchmarks\n";
@@ -305,16 +579,28 @@ void parse_args(int argc, char *argv[])
       std::cout << "  --help: print this help message\n";
       std::exit(0);
     }
+    else if (argv[i][0] != '-')
+    {
+      // libFuzzer style seed files and directories
+      add_seed_path(argv[i]);
+    }
     else
     {
       std::cerr << "Unknown option: " << argv[i] << "\n";
       std::exit(1);
     }
   }
+  if (get_shard_count() == 0 || get_shard_index() >= get_shard_count())
+  {
+    std::cerr << "Shard index must be less than the shard count\n";
+    std::exit(1);
+  }
 }
 
 int main(int argc, char **argv)
 {
+  valfuzz::libfuzzer_initialize(&argc, &argv);
+  valfuzz::register_libfuzzer_target();
   valfuzz::parse_args(argc, argv);
   if (valfuzz::get_header())
     valfuzz::print_header();
@@ -322,12 +608,19 @@ int main(int argc, char **argv)
   auto &seed = valfuzz::get_seed();
   std::srand((unsigned int) seed);
 
-  std::mt19937 gen = valfuzz::get_random_engine();
-  gen.seed(seed.load());
+  valfuzz::seed_random_engine(0);
 
   valfuzz::get_function_execute_before()();
 
-  if (valfuzz::get_do_benchmarks())
+  if (valfuzz::get_replay_file().has_value())
+  {
+    valfuzz::replay_fuzz(valfuzz::get_replay_file().value());
+  }
+  else if (valfuzz::get_minimize_file().has_value())
+  {
+    valfuzz::minimize_fuzz(valfuzz::get_minimize_file().value());
+  }
+  else if (valfuzz::get_do_benchmarks())
   {
     {
       std::lock_guard<std::mutex> lock(valfuzz::get_stream_mutex());
@@ -351,12 +644,19 @@ int main(int argc, char **argv)
     }
     else
     {
+      valfuzz::shard_tests();
+      valfuzz::order_tests();
       {
         std::lock_guard<std::mutex> lock(valfuzz::get_stream_mutex());
         std::cout << "Seed: " << seed << "\n";
-        std::cout << "Running " << valfuzz::get_num_tests() << " tests...\n";
+        std::cout << "Running " << valfuzz::get_num_tests() << " tests";
+        if (valfuzz::get_shard_count() > 1)
+          std::cout << " of shard " << valfuzz::get_shard_index() << "/"
+                    << valfuzz::get_shard_count();
+        std::cout << "...\n";
       }
       valfuzz::run_tests();
+      valfuzz::save_test_timings();
     }
   }
   else
@@ -376,6 +676,7 @@ int main(int argc, char **argv)
   }
 
   valfuzz::get_function_execute_after()();
+  valfuzz::log_drain();
 
   if (valfuzz::get_has_failed_once())
   {
@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <valfuzz/scheduler.hpp>
+#include <valfuzz/valfuzz.hpp>
+
+TEST(checkpoint_roundtrip, "Checkpoint states are written and read back")
+{
+  std::filesystem::path dir = std::filesystem::temp_directory_path() /
+                              ("valfuzz_checkpoint_" +
+                               std::to_string(valfuzz::get_seed()));
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir);
+
+  valfuzz::checkpoint state;
+  state.seed       = 0xdeadbeefcafe;
+  state.iterations = 123456;
+  state.targets    = {"first target", "second"};
+  state.workers.push_back({1000, {600, 400}, {64.0, 1.0}});
+  state.workers.push_back({7, {3, 4}, {1.3, 10.0 / 3.0}});
+  ASSERT(valfuzz::write_checkpoint_state(dir / "state", state));
+
+  auto read = valfuzz::read_checkpoint_state(dir / "state");
+  ASSERT(read.has_value());
+  if (read.has_value())
+  {
+    ASSERT_EQ(read->seed, state.seed);
+    ASSERT_EQ(read->iterations, state.iterations);
+    ASSERT(read->targets == state.targets);
+    ASSERT_EQ(read->workers.size(), 2u);
+    ASSERT_EQ(read->workers[0].next_iteration, 1000u);
+    ASSERT(read->workers[1].execs == state.workers[1].execs);
+    // energies are written with every digit
+    ASSERT(read->workers[1].energies == state.workers[1].energies);
+  }
+
+  ASSERT(!valfuzz::read_checkpoint_state(dir / "missing").has_value());
+  std::filesystem::remove_all(dir);
+}
+
+TEST(scheduler_set_energy, "Restored energies are clamped")
+{
+  valfuzz::scheduler scheduler(2);
+  scheduler.set_energy(0, 2.5);
+  scheduler.set_energy(1, 100.0);
+  ASSERT_EQ(scheduler.energy(0), 2.5);
+  ASSERT_EQ(scheduler.energy(1), SCHEDULER_MAX_ENERGY);
+  scheduler.set_energy(0, 0.0);
+  ASSERT_EQ(scheduler.energy(0), SCHEDULER_MIN_ENERGY);
+}
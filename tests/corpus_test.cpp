@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <valfuzz/valfuzz.hpp>
+
+TEST(corpus_save_load, "Corpus inputs are saved and packed")
+{
+  std::filesystem::path dir = std::filesystem::temp_directory_path() /
+                              ("valfuzz_corpus_" +
+                               std::to_string(valfuzz::get_seed()));
+  std::filesystem::remove_all(dir);
+
+  const uint8_t a[] = {1, 2, 3};
+  const uint8_t b[] = {4, 5};
+  valfuzz::save_input(dir, a, sizeof(a));
+  valfuzz::save_input(dir, b, sizeof(b));
+  valfuzz::save_input(dir, a, sizeof(a));
+  ASSERT(std::filesystem::exists(dir / valfuzz::input_file_name(a, 3)));
+
+  // the first load packs the loose files
+  auto inputs = valfuzz::load_inputs(dir);
+  ASSERT_EQ(inputs.size(), 2u);
+  ASSERT(std::filesystem::exists(dir / CORPUS_PACK_NAME));
+
+  // the second load reads them from the pack only
+  std::filesystem::remove(dir / valfuzz::input_file_name(b, 2));
+  inputs = valfuzz::load_inputs(dir);
+  ASSERT_EQ(inputs.size(), 2u);
+  bool found_b = false;
+  for (auto &input : inputs)
+  {
+    found_b |= input == std::vector<uint8_t>(b, b + sizeof(b));
+  }
+  ASSERT(found_b);
+
+  std::filesystem::remove_all(dir);
+}
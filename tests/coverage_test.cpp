@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <valfuzz/valfuzz.hpp>
+
+TEST(coverage_update, "Coverage finds new edges once")
+{
+  // hit a guard by hand, this works without instrumentation
+  uint32_t guard = 7;
+  auto run_input = [&guard](int hits)
+  {
+    valfuzz::coverage_reset();
+    for (int i = 0; i < hits; i++)
+    {
+      __sanitizer_cov_trace_pc_guard(&guard);
+    }
+    return valfuzz::coverage_update();
+  };
+  valfuzz::coverage_thread_init();
+  run_input(1);
+  ASSERT(!run_input(1));
+  // a different hit count is new coverage
+  ASSERT(run_input(3));
+}
+
+TEST(coverage_cmp_operands, "Comparison operands become dictionary tokens")
+{
+  valfuzz::coverage_thread_init();
+  std::vector<std::vector<uint8_t>> tokens;
+  auto take = [&tokens]()
+  {
+    tokens.clear();
+    valfuzz::coverage_take_cmp_operands(
+      [&tokens](const uint8_t *token, size_t size)
+      { tokens.emplace_back(token, token + size); });
+  };
+  take();
+
+  const uint32_t deadbeef = 0xdeadbeef;
+  const char magic[]      = "MAGIC";
+  for (uint32_t batch = 0; batch < 2; batch++)
+  {
+    // the same comparison sites in both batches
+    __sanitizer_cov_trace_const_cmp4(deadbeef, batch);
+    __sanitizer_cov_trace_const_cmp8(0, 42);
+    __sanitizer_weak_hook_memcmp(nullptr, "xxxxx", magic, 5, 1);
+    take();
+    bool found_int = false, found_magic = false, found_zero = false;
+    for (const auto &token : tokens)
+    {
+      found_int |= token.size() == 4 &&
+                   std::memcmp(token.data(), &deadbeef, 4) == 0;
+      found_magic |= token == std::vector<uint8_t>(magic, magic + 5);
+      found_zero |= token == std::vector<uint8_t>(8, 0);
+    }
+    // operands are passed on only when they change
+    ASSERT_EQ(found_int, batch == 0);
+    ASSERT_EQ(found_magic, batch == 0);
+    // zero is not worth a token
+    ASSERT(!found_zero);
+  }
+}
+
+TEST(coverage_cmp_strings, "String comparisons record each side's own length")
+{
+  valfuzz::coverage_thread_init();
+  std::vector<std::vector<uint8_t>> tokens;
+  auto take = [&tokens]()
+  {
+    tokens.clear();
+    valfuzz::coverage_take_cmp_operands(
+      [&tokens](const uint8_t *token, size_t size)
+      { tokens.emplace_back(token, token + size); });
+  };
+  take();
+
+  // a 2 byte buffer, reading 6 bytes of it would go past its end
+  const char shorter[] = "a";
+  __sanitizer_weak_hook_strcmp(nullptr, shorter, "abcdef", -1);
+  take();
+  bool found_short = false, found_long = false;
+  for (const auto &token : tokens)
+  {
+    found_short |= token == std::vector<uint8_t>{'a'};
+    found_long |= token == std::vector<uint8_t>{'a', 'b', 'c', 'd', 'e', 'f'};
+    ASSERT_LE(token.size(), 6u);
+  }
+  ASSERT(found_short);
+  ASSERT(found_long);
+}
@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <valfuzz/valfuzz.hpp>
+
+TEST(provider_fixed_input, "Provider decodes a fixed input")
+{
+  const uint8_t input[] = {0x01, 0x02, 0x03, 0x04, 0x05, 'a', 'b', 'c'};
+  valfuzz::data_provider provider(input, sizeof(input));
+  ASSERT_EQ(provider.consume<uint32_t>(), 0x04030201u);
+  ASSERT_EQ(provider.consume<bool>(), true);
+  std::string_view rest = provider.consume_remaining();
+  ASSERT_EQ(rest, "abc");
+  ASSERT(rest.data() == reinterpret_cast<const char *>(input + 5));
+  // exhausted inputs give zeros
+  ASSERT_EQ(provider.consume<int>(), 0);
+  ASSERT_EQ(provider.remaining(), 0u);
+}
+
+TEST(provider_range, "Provider values in range")
+{
+  const uint8_t input[] = {0xff, 0xff, 0xff, 0xff, 0x10, 0x20, 0x30, 0x40,
+                           0x50, 0x60, 0x70, 0x80, 0x90, 0xa0, 0xb0, 0xc0};
+  valfuzz::data_provider provider(input, sizeof(input));
+  int value = provider.consume_in_range<int>(-3, 3);
+  ASSERT_GE(value, -3);
+  ASSERT_LE(value, 3);
+  double real = provider.consume_in_range<double>(1.0, 2.0);
+  ASSERT_GE(real, 1.0);
+  ASSERT_LE(real, 2.0);
+
+  // the whole range of the type does not overflow
+  for (int i = 0; i < 64; i++)
+  {
+    uint8_t bytes[sizeof(uint64_t) * 2];
+    valfuzz::get_random_bytes(valfuzz::get_random_engine(), bytes,
+                              sizeof(bytes));
+    valfuzz::data_provider wide(bytes, sizeof(bytes));
+    double d = wide.consume_in_range<double>(
+      std::numeric_limits<double>::lowest(), std::numeric_limits<double>::max());
+    ASSERT(std::isfinite(d));
+    float f = wide.consume_in_range<float>(std::numeric_limits<float>::lowest(),
+                                           std::numeric_limits<float>::max());
+    ASSERT(std::isfinite(f));
+  }
+}
+
+TEST(provider_random_input, "Provider records random inputs")
+{
+  uint8_t buffer[MAX_FUZZ_INPUT_SIZE];
+  valfuzz::random_engine engine(1234);
+  valfuzz::data_provider random(buffer, sizeof(buffer), engine);
+  uint64_t a    = random.consume<uint64_t>();
+  int b         = random.consume_in_range<int>(-1000, 1000);
+  double c      = random.consume_in_range<double>(-1.0, 1.0);
+  std::string d = std::string(random.consume_string(64));
+  random.materialize();
+
+  // the recorded input replays the same values, and nothing else
+  valfuzz::data_provider replay(random.data(), random.size());
+  ASSERT_EQ(replay.consume<uint64_t>(), a);
+  ASSERT_EQ(replay.consume_in_range<int>(-1000, 1000), b);
+  ASSERT_EQ(replay.consume_in_range<double>(-1.0, 1.0), c);
+  ASSERT_EQ(replay.consume_string(64), d);
+  ASSERT_EQ(replay.consumed(), random.consumed());
+  ASSERT_EQ(replay.remaining(), random.remaining());
+}
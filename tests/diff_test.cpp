@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <cmath>
+#include <sstream>
+#include <valfuzz/valfuzz.hpp>
+
+TEST(diff_equal, "Differential outputs are compared with a tolerance")
+{
+  ASSERT(valfuzz::diff_equal(1, 1, 0.0));
+  ASSERT(!valfuzz::diff_equal(1, 2, 0.5));
+  ASSERT(!valfuzz::diff_equal(1.0f, 1.0001f, 0.0));
+  ASSERT(valfuzz::diff_equal(1.0f, 1.0001f, 1e-3));
+  // relative to the larger value
+  ASSERT(valfuzz::diff_equal(1000.0, 1000.5, 1e-3));
+  ASSERT(valfuzz::diff_equal(std::nan(""), std::nan(""), 0.0));
+  ASSERT(!valfuzz::diff_equal(std::nan(""), 1.0, 1.0));
+
+  std::vector<double> a = {1.0, 2.0};
+  std::vector<double> b = {1.0, 2.0 + 1e-9};
+  ASSERT(valfuzz::diff_equal(a, b, 1e-6));
+  ASSERT(!valfuzz::diff_equal(a, b, 0.0));
+  b.push_back(3.0);
+  ASSERT(!valfuzz::diff_equal(a, b, 1e-6));
+}
+
+TEST(diff_print, "Differential inputs are printed")
+{
+  std::ostringstream out;
+  valfuzz::diff_print(out, std::vector<unsigned char>{1, 2, 255});
+  ASSERT_EQ(out.str(), "{1, 2, 255}");
+
+  out.str("");
+  valfuzz::diff_print(out, std::vector<int>(20, 0));
+  ASSERT_EQ(out.str(), "{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ...}");
+}
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <valfuzz/valfuzz.hpp>
+
+TEST(failure_buckets, "Failures are counted in buckets by signature")
+{
+  // a table of its own, the failures are not real
+  auto table             = std::make_unique<valfuzz::failure_table>();
+  const std::string name = "bucket test";
+  const uint64_t first   = valfuzz::failure_signature(name, "a.cpp", 10);
+  const uint64_t second  = valfuzz::failure_signature(name, "a.cpp", 11);
+  ASSERT_NE(first, second);
+  ASSERT_NE(first, valfuzz::crash_signature(name, 11, 0));
+  ASSERT_NE(valfuzz::crash_signature(name, 11, 1),
+            valfuzz::crash_signature(name, 11, 2));
+
+  ASSERT(valfuzz::count_failure(first, name, "a.cpp", 10, *table));
+  ASSERT(!valfuzz::count_failure(first, name, "a.cpp", 10, *table));
+  ASSERT(!valfuzz::count_failure(first, name, "a.cpp", 10, *table));
+  ASSERT(valfuzz::count_failure(second, name, "a.cpp", 11, *table));
+  ASSERT_EQ(valfuzz::failure_count(first, *table), 3u);
+  ASSERT_EQ(valfuzz::failure_count(second, *table), 1u);
+
+  // one reproducer per bucket
+  ASSERT(valfuzz::claim_failure(first, *table));
+  ASSERT(!valfuzz::claim_failure(first, *table));
+  ASSERT(valfuzz::claim_failure(second, *table));
+  ASSERT_EQ(valfuzz::failure_count(first), 0u);
+}
+
+static uint64_t backtrace_here()
+{
+  return valfuzz::backtrace_signature();
+}
+
+TEST(failure_backtrace, "Backtraces hash the same call site the same")
+{
+  valfuzz::backtrace_init();
+  uint64_t first = 0, second = 0;
+  for (int i = 0; i < 2; i++)
+  {
+    (i == 0 ? first : second) = backtrace_here();
+  }
+  ASSERT_NE(first, 0u);
+  ASSERT_EQ(first, second);
+}
@@ -68,3 +68,32 @@ TEST(random_string, "Generate a random string")
     std::cout << "Generated string: " << generated << "\n";
   }
 }
+
+TEST(random_streams, "Random streams are reproducible")
+{
+  valfuzz::seed_random_engine(3);
+  int first = valfuzz::get_random<int>();
+  valfuzz::seed_random_engine(3);
+  ASSERT_EQ(first, valfuzz::get_random<int>());
+
+  valfuzz::random_engine a(42);
+  valfuzz::random_engine b(42);
+  b.jump();
+  ASSERT_NE(a(), b());
+}
+
+TEST(iteration_seeds, "Every fuzz iteration has its own seed")
+{
+  ASSERT_EQ(valfuzz::iteration_seed(2, 17), valfuzz::iteration_seed(2, 17));
+
+  std::vector<uint64_t> seeds;
+  for (uint64_t worker = 0; worker < 8; worker++)
+  {
+    for (uint64_t iteration = 0; iteration < 1000; iteration++)
+    {
+      seeds.push_back(valfuzz::iteration_seed(worker, iteration));
+    }
+  }
+  std::sort(seeds.begin(), seeds.end());
+  ASSERT(std::adjacent_find(seeds.begin(), seeds.end()) == seeds.end());
+}
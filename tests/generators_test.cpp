@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <cmath>
+#include <valfuzz/valfuzz.hpp>
+
+TEST(generate_multiply_high, "128 bit products are exact")
+{
+  uint64_t low;
+  ASSERT_EQ(valfuzz::multiply_high(UINT64_MAX, UINT64_MAX, low),
+            UINT64_MAX - 1);
+  ASSERT_EQ(low, 1u);
+  ASSERT_EQ(valfuzz::multiply_high(uint64_t{1} << 63, 4, low), 2u);
+  ASSERT_EQ(low, 0u);
+  ASSERT_EQ(valfuzz::multiply_high(0x123456789, 0x10, low), 0u);
+  ASSERT_EQ(low, 0x1234567890u);
+}
+
+TEST(generate_in_range, "Bounded values cover the whole range")
+{
+  valfuzz::random_engine engine(3);
+  bool seen[7] = {};
+  for (int i = 0; i < 1000; i++)
+  {
+    int8_t value = valfuzz::generate_in_range<int8_t>(engine, -3, 3);
+    ASSERT_GE(value, -3);
+    ASSERT_LE(value, 3);
+    seen[value + 3] = true;
+  }
+  for (bool s : seen)
+  {
+    ASSERT(s);
+  }
+  ASSERT_EQ(valfuzz::generate_in_range<int>(engine, 5, 5), 5);
+  // the full range does not overflow
+  int64_t any = valfuzz::generate_in_range<int64_t>(engine, INT64_MIN,
+                                                    INT64_MAX);
+  (void) any;
+  double unit = valfuzz::generate_in_range<double>(engine, 0.0, 1.0);
+  ASSERT(unit >= 0.0 && unit <= 1.0);
+}
+
+TEST(generate_wide_float_range, "Floats cover a range as wide as the type")
+{
+  valfuzz::random_engine engine(5);
+  const double lowest = std::numeric_limits<double>::lowest();
+  const double max    = std::numeric_limits<double>::max();
+  bool negative = false, positive = false, not_max = false;
+  for (int i = 0; i < 1000; i++)
+  {
+    double value = valfuzz::generate_in_range<double>(engine, lowest, max);
+    ASSERT(std::isfinite(value));
+    negative |= value < 0;
+    positive |= value > 0;
+    not_max |= value != max;
+    float f = valfuzz::generate_in_range<float>(
+      engine, std::numeric_limits<float>::lowest(),
+      std::numeric_limits<float>::max());
+    ASSERT(std::isfinite(f));
+  }
+  ASSERT(negative);
+  ASSERT(positive);
+  ASSERT(not_max);
+}
+
+TEST(generate_full_width, "Integers and floats cover their whole type")
+{
+  valfuzz::random_engine engine(11);
+  bool negative = false, large = false, nan = false, inf = false;
+  for (int i = 0; i < 10000; i++)
+  {
+    int64_t value = valfuzz::generate<int64_t>(engine);
+    negative |= value < 0;
+    large |= value > (int64_t{1} << 62);
+    float f = valfuzz::generate<float>(engine);
+    nan |= std::isnan(f);
+    inf |= std::isinf(f);
+  }
+  ASSERT(negative);
+  ASSERT(large);
+  ASSERT(nan);
+  ASSERT(inf);
+}
+
+TEST(generate_reuse, "Generating into a grown buffer does not allocate")
+{
+  valfuzz::random_engine engine(1);
+  std::string text;
+  text.reserve(64);
+  const char *buffer = text.data();
+  std::vector<uint16_t> values;
+  values.reserve(64);
+  const uint16_t *values_buffer = values.data();
+  for (int i = 0; i < 1000; i++)
+  {
+    valfuzz::generate_string(engine, text, 64, "abc");
+    ASSERT_LE(text.size(), 64u);
+    ASSERT_EQ(text.find_first_not_of("abc"), std::string::npos);
+    valfuzz::generate_vector(engine, values, 64);
+    ASSERT_LE(values.size(), 64u);
+  }
+  ASSERT(text.data() == buffer);
+  ASSERT(values.data() == values_buffer);
+}
@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <valfuzz/valfuzz.hpp>
+
+TEST(isolated_slot_ring, "Isolated workers pass corpus entries in order")
+{
+  auto slot = std::make_unique<valfuzz::isolated_slot>();
+  valfuzz::corpus_entry entry{3, std::vector<uint8_t>(1000, 0xab)};
+  valfuzz::corpus_entry out;
+
+  // go around the ring a few times
+  for (int i = 0; i < 200; i++)
+  {
+    entry.data[0] = (uint8_t) i;
+    ASSERT(slot->push(entry));
+    ASSERT(slot->pop(out));
+    ASSERT_EQ(out.target, 3u);
+    ASSERT(out.data == entry.data);
+  }
+  ASSERT(!slot->pop(out));
+
+  // a full ring drops entries instead of blocking
+  size_t pushed = 0;
+  while (slot->push(entry))
+  {
+    pushed++;
+  }
+  ASSERT_EQ(pushed, ISOLATED_RING_SIZE / (8 + 1000));
+}
+
+TEST(isolated_slot_reproducer, "Generated inputs are rebuilt from the engine")
+{
+  auto slot = std::make_unique<valfuzz::isolated_slot>();
+  valfuzz::random_engine engine(7);
+  slot->record_generated(0, engine);
+
+  std::vector<uint8_t> buffer(MAX_FUZZ_INPUT_SIZE);
+  valfuzz::data_provider provider(buffer.data(), buffer.size(), engine);
+  provider.materialize();
+
+  auto repro = valfuzz::slot_reproducer(*slot);
+  ASSERT(repro.data == std::vector<uint8_t>(provider.data(),
+                                            provider.data() + provider.size()));
+  ASSERT_EQ(repro.engine(), engine());
+}
@@ -0,0 +1,30 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <valfuzz/valfuzz.hpp>
+
+static thread_local size_t libfuzzer_last_size = 0;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *, size_t size)
+{
+  libfuzzer_last_size = size;
+  return 0;
+}
+
+TEST(libfuzzer_target, "libFuzzer targets get the whole input")
+{
+  const auto &fuzzs = valfuzz::get_fuzzs();
+  auto fuzz         = std::find_if(fuzzs.begin(), fuzzs.end(),
+                                   [](const valfuzz::fuzz_pair &f)
+                                   { return f.first == LIBFUZZER_TARGET_NAME; });
+  ASSERT(fuzz != fuzzs.end());
+  if (fuzz == fuzzs.end())
+    return;
+
+  const uint8_t input[] = "some input";
+  valfuzz::data_provider provider(input, sizeof(input));
+  fuzz->second(fuzz->first, provider);
+  ASSERT_EQ(libfuzzer_last_size, sizeof(input));
+}
@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <valfuzz/valfuzz.hpp>
+
+TEST(log_lines, "Log lines are written whole and in order")
+{
+  std::ostringstream out;
+  valfuzz::log_line(out) << "first " << 1 << std::endl;
+  valfuzz::log_line(out) << "second " << 2.5 << "\n";
+  valfuzz::log_drain();
+  ASSERT_EQ(out.str(), std::string("first 1\nsecond 2.5\n"));
+}
+
+TEST(log_groups, "The lines of a group stay together")
+{
+  std::ostringstream out;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++)
+  {
+    threads.emplace_back(
+      [&out, t]()
+      {
+        for (int group = 0; group < 50; group++)
+        {
+          valfuzz::log_begin_group();
+          for (int line = 0; line < 3; line++)
+          {
+            valfuzz::log_line(out) << t << " " << group << " " << line << "\n";
+          }
+          valfuzz::log_end_group();
+        }
+      });
+  }
+  for (auto &thread : threads)
+  {
+    thread.join();
+  }
+  valfuzz::log_drain();
+
+  std::istringstream in(out.str());
+  std::vector<int> next_group(4, 0);
+  int lines = 0;
+  int t, group, line;
+  bool together = true;
+  while (in >> t >> group >> line)
+  {
+    // every group is three consecutive lines, and the groups of a
+    // thread come in order
+    together = together && line == lines % 3 && group == next_group[t];
+    if (line == 2)
+      next_group[t]++;
+    lines++;
+  }
+  ASSERT(together);
+  ASSERT_EQ(lines, 4 * 50 * 3);
+}
+
+TEST(log_errors, "Errors are not held by a group")
+{
+  std::ostringstream out;
+  std::atomic<int> step = 0;
+  std::thread test(
+    [&]()
+    {
+      valfuzz::log_begin_group();
+      valfuzz::log_line(out) << "held\n";
+      valfuzz::log_line(std::cerr) << "";
+      // still in the group, like a test that hangs
+      step = 1;
+      while (step != 2)
+      {
+        std::this_thread::yield();
+      }
+      valfuzz::log_end_group();
+    });
+  while (step != 1)
+  {
+    std::this_thread::yield();
+  }
+  // the error pushed the line held before it
+  valfuzz::log_drain();
+  ASSERT_EQ(out.str(), std::string("held\n"));
+  step = 2;
+  test.join();
+}
@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <valfuzz/valfuzz.hpp>
+
+TEST(minimizer_candidates, "Minimizer candidates remove or lower bytes")
+{
+  std::vector<uint8_t> input = {1, 2, 3, 4, 5};
+  std::vector<uint8_t> out;
+  valfuzz::apply_candidate(input, {1, 3, -1}, out);
+  ASSERT(out == std::vector<uint8_t>({1, 4, 5}));
+  valfuzz::apply_candidate(input, {4, 5, 0}, out);
+  ASSERT(out == std::vector<uint8_t>({1, 2, 3, 4, 0}));
+}
+
+TEST(minimizer_shrinks, "Minimizer keeps only the failing bytes")
+{
+  // fails if an 'x' comes before a 'y'
+  valfuzz::minimize_predicate fails = [](const std::vector<uint8_t> &input)
+  {
+    auto x = std::find(input.begin(), input.end(), 'x');
+    return std::find(x, input.end(), 'y') != input.end();
+  };
+
+  valfuzz::random_engine engine(valfuzz::get_seed());
+  std::vector<uint8_t> input(3000);
+  valfuzz::get_random_bytes(engine, input.data(), input.size());
+  std::replace(input.begin(), input.end(), (uint8_t) 'x', (uint8_t) 'z');
+  std::replace(input.begin(), input.end(), (uint8_t) 'y', (uint8_t) 'z');
+  input[123]  = 'x';
+  input[2345] = 'y';
+
+  size_t runs = 0;
+  auto single = valfuzz::minimize_input(input, fails, 1, &runs);
+  ASSERT(single == std::vector<uint8_t>({'x', 'y'}));
+  ASSERT_GT(runs, 0);
+
+  // the first failing candidate wins, whatever the number of threads
+  auto parallel = valfuzz::minimize_input(input, fails, 4);
+  ASSERT(parallel == single);
+}
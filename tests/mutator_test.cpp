@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <valfuzz/mutator.hpp>
+#include <valfuzz/valfuzz.hpp>
+
+TEST(mutator_max_size, "Mutations respect the maximum size")
+{
+  valfuzz::random_engine engine(99);
+  valfuzz::mutator mutator(engine);
+  std::vector<uint8_t> other(100, 0xaa);
+  std::vector<uint8_t> data(10, 0);
+  for (int i = 0; i < 10000; i++)
+  {
+    mutator.mutate(data, 64, &other);
+    ASSERT_LE(data.size(), 64u);
+  }
+}
+
+TEST(mutator_operators, "Every mutation operator applies")
+{
+  valfuzz::random_engine engine(7);
+  valfuzz::mutator mutator(engine);
+  const uint8_t token[] = {'M', 'A', 'G', 'I', 'C'};
+  mutator.add_token(token, sizeof(token));
+  mutator.add_token(token, sizeof(token));
+  ASSERT_EQ(mutator.dictionary_size(), 1u);
+
+  std::vector<uint8_t> other(16, 0x55);
+  for (int m = 0; m < (int) valfuzz::mutation::count; m++)
+  {
+    std::vector<uint8_t> data(16, 0);
+    ASSERT(mutator.mutate_with((valfuzz::mutation) m, data, 64, &other));
+    ASSERT_LE(data.size(), 64u);
+  }
+}
+
+TEST(mutator_scheduler, "Rewarded mutations are counted")
+{
+  valfuzz::random_engine engine(3);
+  valfuzz::mutator mutator(engine);
+  std::vector<uint8_t> data(32, 0);
+  long unsigned int successes = 0;
+  long unsigned int uses      = 0;
+  for (int i = 0; i < 100; i++)
+  {
+    mutator.mutate(data, 64);
+    mutator.reward();
+  }
+  for (int m = 0; m < (int) valfuzz::mutation::count; m++)
+  {
+    successes += mutator.successes((valfuzz::mutation) m);
+    uses += mutator.uses((valfuzz::mutation) m);
+  }
+  ASSERT_GT(uses, 0u);
+  ASSERT_EQ(successes, uses);
+}
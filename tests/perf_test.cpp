@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <valfuzz/valfuzz.hpp>
+
+TEST(perf_metrics, "Performance metrics are parsed")
+{
+  ASSERT(valfuzz::parse_perf_metric("time") == valfuzz::perf_metric::time);
+  ASSERT(valfuzz::parse_perf_metric("edges") == valfuzz::perf_metric::edges);
+  ASSERT(valfuzz::parse_perf_metric("instructions") ==
+         valfuzz::perf_metric::instructions);
+  ASSERT(!valfuzz::parse_perf_metric("cycles").has_value());
+  ASSERT_EQ(valfuzz::perf_read(valfuzz::perf_metric::none), 0);
+}
+
+TEST(perf_measure, "Failed readings measure nothing")
+{
+  ASSERT_EQ(valfuzz::perf_measure(100, 250).value_or(0), 150u);
+  ASSERT(!valfuzz::perf_measure(100, 0).has_value());
+  ASSERT(!valfuzz::perf_measure(0, 250).has_value());
+  ASSERT(!valfuzz::perf_measure(250, 100).has_value());
+  ASSERT(!valfuzz::perf_measure(0, 0).has_value());
+}
+
+TEST(perf_slowest, "Only clearly slower inputs become the slowest")
+{
+  valfuzz::perf_reset(2);
+  ASSERT(valfuzz::perf_update(0, 100));
+  ASSERT(!valfuzz::perf_update(0, 105));  // within PERF_CORPUS_GAIN
+  ASSERT(valfuzz::perf_update(0, 200));
+  ASSERT_EQ(valfuzz::perf_slowest(0), 200);
+  ASSERT_EQ(valfuzz::perf_slowest(1), 0);
+}
+
+TEST(perf_slow_inputs, "Every input over the threshold is slow")
+{
+  ASSERT(!valfuzz::perf_is_slow(valfuzz::perf_metric::edges, 1000));
+  valfuzz::set_slow_input_threshold(100);
+  ASSERT(!valfuzz::perf_is_slow(valfuzz::perf_metric::edges, 99));
+  ASSERT(valfuzz::perf_is_slow(valfuzz::perf_metric::edges, 100));
+  ASSERT(valfuzz::perf_is_slow(valfuzz::perf_metric::edges, 150));
+  valfuzz::set_slow_input_threshold(0);
+}
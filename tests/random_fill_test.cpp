@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <valfuzz/valfuzz.hpp>
+
+#include <vector>
+
+TEST(random_fill_int, "Fill random ints")
+{
+  std::vector<int> values(4099);
+  valfuzz::get_random_fill<int>(values.data(), values.size());
+  for (int v : values)
+  {
+    ASSERT_GE(v, 0);
+  }
+}
+
+TEST(random_fill_float, "Fill random floats")
+{
+  std::vector<float> values(1000);
+  valfuzz::get_random_fill<float>(values.data(), values.size());
+  for (float v : values)
+  {
+    ASSERT_GE(v, -1.0f);
+    ASSERT_LT(v, 1.0f);
+  }
+}
+
+TEST(random_fill_double, "Fill random doubles")
+{
+  std::vector<double> values(1000);
+  valfuzz::get_random_fill<double>(values.data(), values.size());
+  for (double v : values)
+  {
+    ASSERT_GE(v, -1.0);
+    ASSERT_LT(v, 1.0);
+  }
+}
+
+TEST(random_fill_bool, "Fill random bools")
+{
+  bool values[777];
+  valfuzz::get_random_fill<bool>(values, 777);
+  int trues = 0;
+  for (bool v : values)
+  {
+    trues += v ? 1 : 0;
+  }
+  ASSERT_GT(trues, 0);
+  ASSERT_LT(trues, 777);
+}
+
+TEST(random_fill_reproducible, "Fill random bytes is reproducible")
+{
+  unsigned char a[1000];
+  unsigned char b[1000];
+  valfuzz::seed_random_engine(7);
+  valfuzz::get_random_fill<unsigned char>(a, sizeof(a));
+  valfuzz::seed_random_engine(7);
+  valfuzz::get_random_fill<unsigned char>(b, sizeof(b));
+  ASSERT(std::memcmp(a, b, sizeof(a)) == 0);
+}
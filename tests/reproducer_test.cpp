@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <valfuzz/valfuzz.hpp>
+
+TEST(reproducer_roundtrip, "Reproducers are written and read back")
+{
+  std::filesystem::path dir = std::filesystem::temp_directory_path() /
+                              ("valfuzz_reproducer_" +
+                               std::to_string(valfuzz::get_seed()));
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir);
+
+  valfuzz::reproducer repro;
+  repro.target = "some target";
+  repro.engine.seed(42);
+  repro.data = {0, '\n', 'a', 255, '\n', '\n'};
+  ASSERT(valfuzz::write_reproducer(dir / "crash", repro));
+
+  auto read = valfuzz::read_reproducer(dir / "crash");
+  ASSERT(read.has_value());
+  if (read.has_value())
+  {
+    ASSERT_EQ(read->target, repro.target);
+    ASSERT(read->data == repro.data);
+    // same state, same stream
+    ASSERT_EQ(read->engine(), repro.engine());
+  }
+
+  repro.cost = "12.5 ms";
+  ASSERT(valfuzz::write_reproducer(dir / "slow", repro));
+  read = valfuzz::read_reproducer(dir / "slow");
+  ASSERT(read.has_value() && read->cost == repro.cost);
+  ASSERT(read.has_value() && read->data == repro.data);
+
+  ASSERT(!valfuzz::read_reproducer(dir / "missing").has_value());
+
+  // a malformed or oversized size is rejected
+  const std::string header = "valfuzz reproducer 1\ntarget: some target\n"
+                             "engine: 1 2 3 4\n";
+  for (const std::string &size :
+       {std::string("size: x\n"), std::string("size: 99999999999999999999\n"),
+        "size: " + std::to_string(MAX_FUZZ_INPUT_SIZE + 1) + "\n"})
+  {
+    {
+      std::ofstream file(dir / "malformed", std::ios::binary);
+      file << header << size << "\n";
+    }
+    ASSERT(!valfuzz::read_reproducer(dir / "malformed").has_value());
+  }
+  std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <valfuzz/scheduler.hpp>
+#include <valfuzz/valfuzz.hpp>
+
+TEST(scheduler_energy, "Productive targets are picked more often")
+{
+  valfuzz::random_engine engine(5);
+  valfuzz::scheduler scheduler(3);
+  // target 1 keeps finding inputs, the others are saturated
+  for (int i = 0; i < 1000; i++)
+  {
+    scheduler.update(0, 0);
+    scheduler.update(1, 1);
+    scheduler.update(2, 0);
+  }
+  ASSERT_EQ(scheduler.energy(0), SCHEDULER_MIN_ENERGY);
+  ASSERT_EQ(scheduler.energy(1), SCHEDULER_MAX_ENERGY);
+  ASSERT_EQ(scheduler.energy(2), SCHEDULER_MIN_ENERGY);
+
+  size_t picks[3] = {};
+  for (int i = 0; i < 10000; i++)
+  {
+    size_t target = scheduler.next(engine);
+    ASSERT_LT(target, 3u);
+    picks[target]++;
+  }
+  ASSERT_GT(picks[1], 9 * (picks[0] + picks[2]));
+  ASSERT_GT(picks[0], 0u);
+  ASSERT_GT(picks[2], 0u);
+}
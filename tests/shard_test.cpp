@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <valfuzz/valfuzz.hpp>
+
+TEST(shard_partition, "Shards partition the tests")
+{
+  std::vector<std::string> names;
+  for (int i = 0; i < 10; i++)
+  {
+    names.push_back("test " + std::to_string(i));
+  }
+  std::vector<size_t> shards = valfuzz::assign_shards(names, 3, {});
+  std::vector<size_t> sizes(3, 0);
+  for (size_t shard : shards)
+  {
+    ASSERT_LT(shard, 3u);
+    sizes[shard]++;
+  }
+  // equal weights give the same number of tests, give or take one
+  ASSERT_EQ(sizes[0], 4u);
+  ASSERT_EQ(sizes[1], 3u);
+  ASSERT_EQ(sizes[2], 3u);
+  // the same in every process
+  ASSERT(valfuzz::assign_shards(names, 3, {}) == shards);
+  ASSERT(valfuzz::assign_shards(names, 1, {}) ==
+         std::vector<size_t>(names.size(), 0));
+}
+
+TEST(shard_timings, "Shards are balanced by the test durations")
+{
+  std::vector<std::string> names = {"a", "b", "c", "d", "e"};
+  valfuzz::test_timings timings  = {{"a", {1.0}}, {"b", {8.0}},
+                                    {"c", {4.0}}, {"d", {3.0}},
+                                    {"e", {1.0}}};
+  std::vector<size_t> shards = valfuzz::assign_shards(names, 2, timings);
+  // b alone on one shard, c + d + a on the other, then e on the first
+  ASSERT_EQ(shards[1], 0u);
+  ASSERT_EQ(shards[2], 1u);
+  ASSERT_EQ(shards[3], 1u);
+  ASSERT_EQ(shards[0], 1u);
+  ASSERT_EQ(shards[4], 0u);
+
+  // tests without a duration count as the mean
+  timings.erase("b");
+  timings["c"] = {9.0};
+  shards       = valfuzz::assign_shards(names, 2, timings);
+  ASSERT_EQ(shards[2], 0u);
+  ASSERT_EQ(shards[1], 1u);
+}
+
+TEST(shard_timings_file, "Timings files round trip and merge")
+{
+  std::filesystem::path dir = std::filesystem::temp_directory_path() /
+                              ("valfuzz_shard_test_" +
+                               std::to_string(std::rand()));
+  std::filesystem::create_directories(dir);
+  valfuzz::test_timings first  = {{"a test", {0.5, 2}}, {"b", {2.25}}};
+  valfuzz::test_timings second = {{"b", {3.0, 0}}, {"c", {1.0}}};
+  ASSERT(valfuzz::write_test_timings(dir / "first", first));
+  ASSERT(valfuzz::write_test_timings(dir / "second", second));
+  valfuzz::test_timings read = valfuzz::read_test_timings(dir / "first");
+  ASSERT_EQ(read.size(), 2u);
+  ASSERT_EQ(read["a test"].seconds, 0.5);
+  ASSERT_EQ(read["a test"].since_failure, 2u);
+  ASSERT_EQ(read["b"].since_failure, TIMINGS_NEVER_FAILED);
+
+  // concatenated, the later file wins
+  {
+    std::ofstream merged(dir / "merged");
+    merged << std::ifstream(dir / "first").rdbuf();
+    merged << std::ifstream(dir / "second").rdbuf();
+  }
+  valfuzz::test_timings merged = valfuzz::read_test_timings(dir / "merged");
+  ASSERT_EQ(merged.size(), 3u);
+  ASSERT_EQ(merged["a test"].seconds, 0.5);
+  ASSERT_EQ(merged["b"].seconds, 3.0);
+  ASSERT_EQ(merged["b"].since_failure, 0u);
+  ASSERT_EQ(merged["c"].seconds, 1.0);
+
+  // files without failures are still read
+  {
+    std::ofstream old(dir / "old");
+    old << TIMINGS_HEADER_V1 << "\n0.75 old test\n";
+  }
+  valfuzz::test_timings old = valfuzz::read_test_timings(dir / "old");
+  ASSERT_EQ(old["old test"].seconds, 0.75);
+  ASSERT_EQ(old["old test"].since_failure, TIMINGS_NEVER_FAILED);
+
+  ASSERT(valfuzz::read_test_timings(dir / "missing").empty());
+  std::filesystem::remove_all(dir);
+}
+
+TEST(shard_history_order, "Recently failed tests run first, then longest")
+{
+  std::vector<std::string> names = {"short", "long", "failed", "new",
+                                    "old failure", "last failure"};
+  valfuzz::test_timings timings  = {{"short", {1.0}},
+                                    {"long", {9.0}},
+                                    {"failed", {0.5, 1}},
+                                    {"old failure", {2.0, TIMINGS_RECENT_RUNS}},
+                                    {"last failure", {0.1, 0}}};
+  std::vector<size_t> order = valfuzz::history_order(names, timings);
+  ASSERT_EQ(order.size(), names.size());
+  ASSERT_EQ(names[order[0]], "last failure");
+  ASSERT_EQ(names[order[1]], "failed");
+  ASSERT_EQ(names[order[2]], "long");
+  // a new test counts as the mean, 2.52
+  ASSERT_EQ(names[order[3]], "new");
+  ASSERT_EQ(names[order[4]], "old failure");
+  ASSERT_EQ(names[order[5]], "short");
+}
@@ -45,3 +45,50 @@ FUZZME(divide_fuzzing, "Divide fuzzing")
     ASSERT_EQ(ret, 0);
   }
 }
+
+FUZZME(provider_fuzzing, "Provider fuzzing")
+{
+  int a = provider.consume<int>();
+  std::string_view s = provider.consume_string(64);
+  ASSERT_LE(s.size(), 64u);
+  ASSERT_EQ(sum_int(a, 0), a);
+}
+
+int sum_loop(const std::vector<int> &v)
+{
+  int sum = 0;
+  for (int x : v)
+  {
+    sum += x;
+  }
+  return sum;
+}
+
+int sum_unrolled(const std::vector<int> &v)
+{
+  int partial[4] = {};
+  size_t i       = 0;
+  for (; i + 4 <= v.size(); i += 4)
+  {
+    partial[0] += v[i];
+    partial[1] += v[i + 1];
+    partial[2] += v[i + 2];
+    partial[3] += v[i + 3];
+  }
+  for (; i < v.size(); i++)
+  {
+    partial[0] += v[i];
+  }
+  return partial[0] + partial[1] + partial[2] + partial[3];
+}
+
+FUZZ_DIFF(sum_diff_fuzzing, "Sum diff fuzzing", sum_loop, sum_unrolled,
+          [](valfuzz::data_provider &provider)
+          {
+            std::vector<int> v(provider.consume_in_range<size_t>(0, 16));
+            for (int &x : v)
+            {
+              x = provider.consume_in_range<int>(-1000, 1000);
+            }
+            return v;
+          });
@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <sstream>
+#include <valfuzz/valfuzz.hpp>
+
+TEST(fuzz_stats_snapshot, "Stats sum executions by target and by worker")
+{
+  valfuzz::fuzz_stats stats;
+  stats.reset(3, 2);
+  stats.add(0, 0, 10);
+  stats.add(0, 1, 5);
+  stats.add(2, 1, 7);
+  stats.add(2, 1, 1);
+
+  auto before = valfuzz::take_stats_snapshot(stats, 1.0);
+  ASSERT_EQ(before.execs, 23u);
+  ASSERT_EQ(before.target_execs[0], 10u);
+  ASSERT_EQ(before.target_execs[1], 13u);
+  ASSERT_EQ(before.worker_execs[0], 15u);
+  ASSERT_EQ(before.worker_execs[1], 0u);
+  ASSERT_EQ(before.worker_execs[2], 8u);
+
+  stats.add(1, 0, 40);
+  auto now = valfuzz::take_stats_snapshot(stats, 3.0);
+  std::ostringstream json;
+  valfuzz::write_stats(json, now, before);
+  ASSERT(json.str().find("\"execs\": 63,") != std::string::npos);
+  ASSERT(json.str().find("\"execs_per_sec\": 20.000,") != std::string::npos);
+
+  // reset drops the old counters
+  stats.reset(1, 1);
+  ASSERT_EQ(stats.get(0, 0), 0u);
+}
@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <valfuzz/valfuzz.hpp>
+
+TEST(thread_pool_tasks, "The thread pool runs every task once")
+{
+  valfuzz::thread_pool pool;
+  pool.start(3);
+  ASSERT_EQ(pool.size(), 3u);
+
+  std::atomic<int> runs = 0;
+  for (int i = 0; i < 1000; i++)
+  {
+    pool.submit(
+      [&pool, &runs]()
+      {
+        // tasks may submit more tasks
+        pool.submit([&runs]() { runs++; });
+        runs++;
+      });
+  }
+  pool.wait();
+  ASSERT_EQ(runs.load(), 2000);
+
+  // the pool is reused after a wait
+  pool.submit([&runs]() { runs++; });
+  pool.wait();
+  ASSERT_EQ(runs.load(), 2001);
+  pool.stop();
+  ASSERT_EQ(pool.size(), 0u);
+}
+
+TEST(thread_pool_parallel_for, "Parallel for covers the range once")
+{
+  std::vector<std::atomic<int>> hits(10007);
+  // from a task of the global pool, while other tests run
+  valfuzz::get_thread_pool().parallel_for(
+    hits.size(),
+    [&hits](size_t begin, size_t end)
+    {
+      for (size_t i = begin; i < end; i++)
+      {
+        hits[i]++;
+      }
+    });
+  bool once = true;
+  for (const auto &hit : hits)
+  {
+    once = once && hit.load() == 1;
+  }
+  ASSERT(once);
+
+  size_t calls = 0;
+  valfuzz::get_thread_pool().parallel_for(
+    0, [&calls](size_t, size_t) { calls++; });
+  ASSERT_LE(calls, 1u);
+}
+
+TEST(thread_pool_parallel_for_nesting,
+     "Parallel for waits only on its own chunks")
+{
+  valfuzz::thread_pool pool;
+  pool.start(2);
+  std::atomic<int> nested = 0;
+  std::atomic<int> runs   = 0;
+  thread_local int depth  = 0;
+  auto other = [&]()
+  {
+    nested += depth > 0;
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+    runs++;
+  };
+  for (int task = 0; task < 4; task++)
+  {
+    pool.submit(
+      [&]()
+      {
+        depth++;
+        // other tasks are queued while the chunks run
+        for (int i = 0; i < 20; i++)
+        {
+          pool.submit(other);
+        }
+        pool.parallel_for(100, [](size_t, size_t) {});
+        depth--;
+      });
+  }
+  pool.wait();
+  ASSERT_EQ(nested.load(), 0);
+  ASSERT_EQ(runs.load(), 80);
+  pool.stop();
+}
@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include <valfuzz/valfuzz.hpp>
+
+static void write_sysfs(const std::filesystem::path &path,
+                        const std::string &value)
+{
+  std::filesystem::create_directories(path.parent_path());
+  std::ofstream file(path);
+  file << value << "\n";
+}
+
+TEST(topology_parse, "Parse cpu lists and cache sizes")
+{
+  ASSERT_EQ(valfuzz::parse_cpu_list("0-3,8,10-11\n").size(), 7u);
+  ASSERT_EQ(valfuzz::parse_cpu_list("5")[0], 5u);
+  ASSERT(valfuzz::parse_cpu_list("").empty());
+  ASSERT(valfuzz::parse_cpu_list("x-y").empty());
+  ASSERT_EQ(valfuzz::parse_cache_size("32K"), 32u * 1024);
+  ASSERT_EQ(valfuzz::parse_cache_size("8M"), 8u * 1024 * 1024);
+  ASSERT_EQ(valfuzz::parse_cache_size("512"), 512u);
+  ASSERT_EQ(valfuzz::parse_cache_size(""), 0u);
+}
+
+TEST(topology_sysfs, "Read the topology of a fake sysfs")
+{
+  // two packages of two cores with two SMT siblings each
+  const std::filesystem::path root =
+    std::filesystem::temp_directory_path() /
+    ("valfuzz_topology_" + std::to_string(valfuzz::get_seed()));
+  std::filesystem::remove_all(root);
+  write_sysfs(root / "cpu" / "online", "0-7");
+  for (int cpu = 0; cpu < 8; cpu++)
+  {
+    const std::filesystem::path dir =
+      root / "cpu" / ("cpu" + std::to_string(cpu)) / "topology";
+    write_sysfs(dir / "physical_package_id", std::to_string(cpu / 4));
+    write_sysfs(dir / "core_id", std::to_string(cpu % 2));
+  }
+  const std::filesystem::path cache = root / "cpu" / "cpu0" / "cache";
+  const char *types[]  = {"Data", "Instruction", "Unified", "Unified"};
+  const char *sizes[]  = {"48K", "32K", "2048K", "32M"};
+  const char *levels[] = {"1", "1", "2", "3"};
+  for (int index = 0; index < 4; index++)
+  {
+    const std::filesystem::path dir =
+      cache / ("index" + std::to_string(index));
+    write_sysfs(dir / "level", levels[index]);
+    write_sysfs(dir / "type", types[index]);
+    write_sysfs(dir / "size", sizes[index]);
+    write_sysfs(dir / "coherency_line_size", "64");
+    write_sysfs(dir / "shared_cpu_list", index < 3 ? "0,1" : "0-3");
+  }
+  write_sysfs(root / "node" / "online", "0-1");
+
+  valfuzz::cpu_topology topology = valfuzz::read_cpu_topology(root);
+  ASSERT_EQ(topology.logical_cpus, 8u);
+  ASSERT_EQ(topology.physical_cores, 4u);
+  ASSERT_EQ(topology.packages, 2u);
+  ASSERT_EQ(topology.numa_nodes, 2u);
+  ASSERT_EQ(topology.caches.size(), 4u);
+  ASSERT_EQ(topology.cache_size(1), 48u * 1024);
+  ASSERT_EQ(topology.cache_size(2), 2048u * 1024);
+  ASSERT_EQ(topology.last_level_cache_size(), 32u * 1024 * 1024);
+  ASSERT_EQ(topology.cache_line_size(), 64u);
+  ASSERT_EQ(topology.caches[3].shared_by, 4u);
+
+  // restricted to the cpus of the first package by the affinity mask
+  topology = valfuzz::read_cpu_topology(root, {0, 1, 2, 3, 42});
+  ASSERT_EQ(topology.logical_cpus, 4u);
+  ASSERT_EQ(topology.physical_cores, 2u);
+  ASSERT_EQ(topology.packages, 1u);
+
+  // without sysfs the counts fall back to the standard library
+  topology = valfuzz::read_cpu_topology(root / "missing");
+  ASSERT(topology.logical_cpus >= 1);
+  ASSERT(topology.caches.empty());
+  ASSERT_EQ(topology.last_level_cache_size(), 0u);
+  ASSERT_EQ(topology.cache_line_size(), (size_t) TOPOLOGY_DEFAULT_LINE_SIZE);
+  std::filesystem::remove_all(root);
+}
+
+TEST(topology_defaults, "The default thread count follows the topology")
+{
+  ASSERT(valfuzz::get_cpu_topology().logical_cpus >= 1);
+  ASSERT_EQ(valfuzz::get_cache_l3_size(),
+            valfuzz::get_cpu_topology().last_level_cache_size());
+}